@@ -153,6 +153,7 @@ scan(void)
         }
 
         xcb_get_geometry_cookie_t *geom_wins[tree_c_len];
+        property_cookies_t *prop_wins[tree_c_len];
 
         for(i = 0; i < tree_c_len; i++)
         {
@@ -176,18 +177,28 @@ scan(void)
             /* Get the geometry of the current window */
             geom_wins[i] = p_alloca(xcb_get_geometry_cookie_t, 1);
             *(geom_wins[i]) = xcb_get_geometry_unchecked(globalconf.connection, wins[i]);
+
+            /* Request all its properties now, so we get them all at once */
+            prop_wins[i] = p_alloca(property_cookies_t, 1);
+            property_cookies_send(wins[i], prop_wins[i]);
         }
 
         for(i = 0; i < tree_c_len; i++)
         {
-            if(!geom_wins[i] || !(geom_r = xcb_get_geometry_reply(globalconf.connection,
-                                                                  *(geom_wins[i]), NULL)))
+            if(!geom_wins[i])
+                continue;
+
+            if(!(geom_r = xcb_get_geometry_reply(globalconf.connection,
+                                                 *(geom_wins[i]), NULL)))
+            {
+                property_cookies_discard(prop_wins[i]);
                 continue;
+            }
 
             /* The window can be mapped, so force it to be undrawn for startup */
             xcb_unmap_window(globalconf.connection, wins[i]);
 
-            client_manage(wins[i], geom_r, phys_screen, true);
+            client_manage(wins[i], geom_r, prop_wins[i], phys_screen, true);
 
             p_delete(&geom_r);
         }
@@ -199,6 +210,7 @@ scan(void)
 static void
 a_refresh_cb(EV_P_ ev_prepare *w, int revents)
 {
+    signal_object_emit_pending(globalconf.L);
     awesome_refresh();
 }
 
@@ -230,6 +242,8 @@ a_xcb_check_cb(EV_P_ ev_check *w, int revents)
         xcb_event_handle(&globalconf.evenths, mouse);
         p_delete(&mouse);
     }
+
+    client_content_check();
 }
 
 static void
@@ -423,6 +437,7 @@ main(int argc, char **argv)
 
     globalconf.loop = ev_default_loop(0);
     ev_timer_init(&globalconf.timer, &luaA_on_timer, 0., 0.);
+    ev_timer_init(&globalconf.redraw_timer, &wibox_redraw_timeout, 0., 0.);
 
     /* register function for signals */
     ev_signal_init(&sigint, exit_on_signal, SIGINT);
@@ -146,6 +146,7 @@ pkg_check_modules(AWESOME_REQUIRED REQUIRED
     xcb-keysyms>=0.3.4
     xcb-icccm>=0.3.6
     xcb-image>=0.3.0
+    xcb-shm
     xcb-property>=0.3.0
     cairo-xcb
     libstartup-notification-1.0>=0.10
@@ -19,9 +19,16 @@
  *
  */
 
+#include <errno.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <xcb/xcbext.h>
+#include <xcb/shm.h>
 #include <xcb/xcb_atom.h>
 #include <xcb/xcb_image.h>
 
+#include "config.h"
 #include "tag.h"
 #include "ewmh.h"
 #include "screen.h"
@@ -32,6 +39,7 @@
 #include "luaa.h"
 #include "common/atoms.h"
 #include "common/xutil.h"
+#include "common/pixel.h"
 
 client_t *
 luaA_client_checkudata(lua_State *L, int ud)
@@ -52,6 +60,9 @@ luaA_client_gc(lua_State *L)
     client_t *c = luaA_checkudata(L, 1, &client_class);
     button_array_wipe(&c->buttons);
     key_array_wipe(&c->keys);
+    key_index_wipe(&c->keys_index);
+    key_grab_array_wipe(&c->keys_grabs);
+    tag_mask_wipe(&c->tags);
     xcb_get_wm_protocols_reply_wipe(&c->protocols);
     p_delete(&c->machine);
     p_delete(&c->class);
@@ -247,9 +258,7 @@ client_maybevisible(client_t *c, screen_t *screen)
         if(c->sticky || c->type == WINDOW_TYPE_DESKTOP)
             return true;
 
-        foreach(tag, screen->tags)
-            if(tag_get_selected(*tag) && is_client_tagged(c, *tag))
-                return true;
+        return tag_mask_intersects(&c->tags, &screen->selected_tags);
     }
     return false;
 }
@@ -261,9 +270,11 @@ client_maybevisible(client_t *c, screen_t *screen)
 client_t *
 client_getbywin(xcb_window_t w)
 {
-    foreach(c, globalconf.clients)
-        if((*c)->window == w)
-            return *c;
+    window_owner_t *owner = window_owner_getbywin(w);
+
+    /* Titlebar windows also reference their client, skip them. */
+    if(owner && !owner->wibox)
+        return owner->client;
 
     return NULL;
 }
@@ -285,7 +296,7 @@ client_unfocus_update(client_t *c)
     }
 
     luaA_object_push(globalconf.L, c);
-    luaA_class_emit_signal(globalconf.L, &client_class, "unfocus", 1);
+    luaA_class_emit_signal_id(globalconf.L, &client_class, SIGNAL_ID("unfocus"), 1);
 }
 
 /** Unfocus a client.
@@ -432,7 +443,7 @@ client_focus_update(client_t *c)
     }
 
     luaA_object_push(globalconf.L, c);
-    luaA_class_emit_signal(globalconf.L, &client_class, "focus", 1);
+    luaA_class_emit_signal_id(globalconf.L, &client_class, SIGNAL_ID("focus"), 1);
 }
 
 /** Give focus to client, or to first client if client is NULL.
@@ -603,16 +614,19 @@ client_stack_refresh()
 /** Manage a new client.
  * \param w The window.
  * \param wgeom Window geometry.
+ * \param cookies The window properties requests, sent by property_cookies_send().
  * \param phys_screen Physical screen number.
  * \param startup True if we are managing at startup time.
  */
 void
-client_manage(xcb_window_t w, xcb_get_geometry_reply_t *wgeom, int phys_screen, bool startup)
+client_manage(xcb_window_t w, xcb_get_geometry_reply_t *wgeom, property_cookies_t *cookies,
+              int phys_screen, bool startup)
 {
-    const uint32_t select_input_val[] = { CLIENT_SELECT_INPUT_EVENT_MASK };
+    xcb_get_property_reply_t *reply;
 
     if(systray_iskdedockapp(w))
     {
+        property_cookies_discard(cookies);
         systray_request_handle(w, phys_screen, NULL);
         return;
     }
@@ -624,8 +638,6 @@ client_manage(xcb_window_t w, xcb_get_geometry_reply_t *wgeom, int phys_screen,
         startup_id_q = xcb_get_any_property(globalconf.connection,
                                             false, w, _NET_STARTUP_ID, UINT_MAX);
 
-    xcb_change_window_attributes(globalconf.connection, w, XCB_CW_EVENT_MASK, select_input_val);
-
     client_t *c = client_new(globalconf.L);
 
     /* This cannot change, ever. */
@@ -634,6 +646,7 @@ client_manage(xcb_window_t w, xcb_get_geometry_reply_t *wgeom, int phys_screen,
     c->isbanned = true;
     /* Store window */
     c->window = w;
+    window_owner_register(w, c, NULL);
     luaA_object_emit_signal(globalconf.L, -1, "property::window", 0);
 
     /* Duplicate client and push it in client list */
@@ -648,14 +661,14 @@ client_manage(xcb_window_t w, xcb_get_geometry_reply_t *wgeom, int phys_screen,
 #define HANDLE_GEOM(attr) \
     c->geometry.attr = wgeom->attr; \
     c->geometries.internal.attr = wgeom->attr; \
-    luaA_object_emit_signal(globalconf.L, -1, "property::" #attr, 0);
+    luaA_object_emit_signal_id(globalconf.L, -1, SIGNAL_ID("property::" #attr), 0);
 HANDLE_GEOM(x)
 HANDLE_GEOM(y)
 HANDLE_GEOM(width)
 HANDLE_GEOM(height)
 #undef HANDLE_GEOM
 
-    luaA_object_emit_signal(globalconf.L, -1, "property::geometry", 0);
+    luaA_object_emit_signal_id(globalconf.L, -1, SIGNAL_ID("property::geometry"), 0);
 
     /* Push client */
     client_set_border_width(globalconf.L, -1, wgeom->border_width);
@@ -665,17 +678,19 @@ HANDLE_GEOM(height)
     luaA_object_emit_signal(globalconf.L, -1, "property::size_hints_honor", 0);
 
     /* update hints */
-    property_update_wm_normal_hints(c, NULL);
-    property_update_wm_hints(c, NULL);
-    property_update_wm_transient_for(c, NULL);
-    property_update_wm_client_leader(c, NULL);
-    property_update_wm_client_machine(c, NULL);
-    property_update_wm_window_role(c, NULL);
-    property_update_net_wm_pid(c, NULL);
-    property_update_net_wm_icon(c, NULL);
+    property_update_from_cookie(c, cookies->wm_normal_hints, property_update_wm_normal_hints);
+    property_update_from_cookie(c, cookies->wm_hints, property_update_wm_hints);
+    property_update_from_cookie(c, cookies->wm_transient_for, property_update_wm_transient_for);
+    property_update_from_cookie(c, cookies->wm_client_leader, property_update_wm_client_leader);
+    property_update_from_cookie(c, cookies->wm_client_machine, property_update_wm_client_machine);
+    property_update_from_cookie(c, cookies->wm_window_role, property_update_wm_window_role);
+    property_update_from_cookie(c, cookies->net_wm_pid, property_update_net_wm_pid);
+    property_update_from_cookie(c, cookies->net_wm_icon, property_update_net_wm_icon);
 
     /* get opacity */
-    client_set_opacity(globalconf.L, -1, window_opacity_get(c->window));
+    reply = xcb_get_property_reply(globalconf.connection, cookies->net_wm_window_opacity, NULL);
+    client_set_opacity(globalconf.L, -1, window_opacity_get_from_reply(reply));
+    p_delete(&reply);
 
     /* Then check clients hints */
     ewmh_client_check_hints(c);
@@ -684,15 +699,15 @@ HANDLE_GEOM(height)
     client_raise(c);
 
     /* update window title */
-    property_update_wm_name(c, NULL);
-    property_update_net_wm_name(c, NULL);
-    property_update_wm_icon_name(c, NULL);
-    property_update_net_wm_icon_name(c, NULL);
-    property_update_wm_class(c, NULL);
-    property_update_wm_protocols(c, NULL);
+    property_update_from_cookie(c, cookies->wm_name, property_update_wm_name);
+    property_update_from_cookie(c, cookies->net_wm_name, property_update_net_wm_name);
+    property_update_from_cookie(c, cookies->wm_icon_name, property_update_wm_icon_name);
+    property_update_from_cookie(c, cookies->net_wm_icon_name, property_update_net_wm_icon_name);
+    property_update_from_cookie(c, cookies->wm_class, property_update_wm_class);
+    property_update_from_cookie(c, cookies->wm_protocols, property_update_wm_protocols);
 
     /* update strut */
-    ewmh_process_client_strut(c, NULL);
+    property_update_from_cookie(c, cookies->net_wm_strut_partial, ewmh_process_client_strut);
 
     ewmh_update_net_client_list(c->phys_screen);
 
@@ -717,8 +732,7 @@ HANDLE_GEOM(height)
     if(!startup)
     {
         /* Request our response */
-        xcb_get_property_reply_t *reply =
-            xcb_get_property_reply(globalconf.connection, startup_id_q, NULL);
+        reply = xcb_get_property_reply(globalconf.connection, startup_id_q, NULL);
         /* Say spawn that a client has been started, with startup id as argument */
         char *startup_id = xutil_get_text_property_from_reply(reply);
         p_delete(&reply);
@@ -840,51 +854,64 @@ client_geometry_hints(client_t *c, area_t geometry)
     return geometry;
 }
 
-/** Resize client window.
+/** Compute the geometry a client gets when asked for one.
  * The sizes given as parameters are with titlebar and borders!
- * \param c Client to resize.
- * \param geometry New window geometry.
+ * \param c The client.
+ * \param geometry The asked geometry, replaced by the one to apply.
+ * \param geometry_internal Set to the window geometry to apply.
  * \param hints Use size hints.
- * \return true if an actual resize occurred.
+ * \return False if the window would be empty.
  */
-bool
-client_resize(client_t *c, area_t geometry, bool hints)
+static bool
+client_geometry_compute(client_t *c, area_t *geometry, area_t *geometry_internal, bool hints)
 {
-    area_t geometry_internal;
-    area_t area;
-
     /* offscreen appearance fixes */
-    area = display_area_get(c->phys_screen);
+    area_t area = display_area_get(c->phys_screen);
 
-    if(geometry.x > area.width)
-        geometry.x = area.width - geometry.width;
-    if(geometry.y > area.height)
-        geometry.y = area.height - geometry.height;
-    if(geometry.x + geometry.width < 0)
-        geometry.x = 0;
-    if(geometry.y + geometry.height < 0)
-        geometry.y = 0;
+    if(geometry->x > area.width)
+        geometry->x = area.width - geometry->width;
+    if(geometry->y > area.height)
+        geometry->y = area.height - geometry->height;
+    if(geometry->x + geometry->width < 0)
+        geometry->x = 0;
+    if(geometry->y + geometry->height < 0)
+        geometry->y = 0;
 
     /* Real client geometry, please keep it contained to C code at the very least. */
-    geometry_internal = titlebar_geometry_remove(c->titlebar, c->border_width, geometry);
+    *geometry_internal = titlebar_geometry_remove(c->titlebar, c->border_width, *geometry);
 
     if(hints)
-        geometry_internal = client_geometry_hints(c, geometry_internal);
+        *geometry_internal = client_geometry_hints(c, *geometry_internal);
 
-    if(geometry_internal.width == 0 || geometry_internal.height == 0)
+    if(geometry_internal->width == 0 || geometry_internal->height == 0)
         return false;
 
     /* Also let client hints propagate to the "official" geometry. */
-    geometry = titlebar_geometry_add(c->titlebar, c->border_width, geometry_internal);
+    *geometry = titlebar_geometry_add(c->titlebar, c->border_width, *geometry_internal);
+
+    return true;
+}
+
+/** Store a new geometry for a client and configure its window, without
+ * emitting anything.
+ * \param c The client.
+ * \param geometry New window geometry, with titlebar and borders.
+ * \param hints Use size hints.
+ * \return true if an actual resize occurred.
+ */
+static bool
+client_geometry_apply(client_t *c, area_t geometry, bool hints)
+{
+    area_t geometry_internal;
+
+    if(!client_geometry_compute(c, &geometry, &geometry_internal, hints))
+        return false;
 
     if(c->geometries.internal.x != geometry_internal.x
        || c->geometries.internal.y != geometry_internal.y
        || c->geometries.internal.width != geometry_internal.width
        || c->geometries.internal.height != geometry_internal.height)
     {
-        screen_t *new_screen = screen_getbycoord(c->screen,
-                                                 geometry_internal.x, geometry_internal.y);
-
         /* Values to configure a window is an array where values are
          * stored according to 'value_mask' */
         uint32_t values[4];
@@ -899,34 +926,126 @@ client_resize(client_t *c, area_t geometry, bool hints)
 
         titlebar_update_geometry(c);
 
-        /* Ignore all spurious enter/leave notify events */
-        client_ignore_enterleave_events();
-
         xcb_configure_window(globalconf.connection, c->window,
                              XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y
                              | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
                              values);
 
-        client_restore_enterleave_events();
+        return true;
+    }
 
-        screen_client_moveto(c, new_screen, false);
+    return false;
+}
 
-        /* execute hook */
-        hook_property(c, "geometry");
+/** Move a resized client to the screen it now lies on and tell about its
+ * new geometry.
+ * \param c The client.
+ * \param old The geometry it had before being resized.
+ */
+static void
+client_geometry_emit(client_t *c, area_t old)
+{
+    screen_client_moveto(c, screen_getbycoord(c->screen,
+                                              c->geometries.internal.x,
+                                              c->geometries.internal.y), false);
 
-        luaA_object_push(globalconf.L, c);
-        luaA_object_emit_signal(globalconf.L, -1, "property::geometry", 0);
-        /** \todo This need to be VERIFIED before it is emitted! */
-        luaA_object_emit_signal(globalconf.L, -1, "property::x", 0);
-        luaA_object_emit_signal(globalconf.L, -1, "property::y", 0);
-        luaA_object_emit_signal(globalconf.L, -1, "property::width", 0);
-        luaA_object_emit_signal(globalconf.L, -1, "property::height", 0);
-        lua_pop(globalconf.L, 1);
+    /* execute hook */
+    hook_property(c, "geometry");
 
-        return true;
+    luaA_object_push(globalconf.L, c);
+    luaA_object_emit_signal_id(globalconf.L, -1, SIGNAL_ID("property::geometry"), 0);
+    if(c->geometry.x != old.x)
+        luaA_object_emit_signal_id(globalconf.L, -1, SIGNAL_ID("property::x"), 0);
+    if(c->geometry.y != old.y)
+        luaA_object_emit_signal_id(globalconf.L, -1, SIGNAL_ID("property::y"), 0);
+    if(c->geometry.width != old.width)
+        luaA_object_emit_signal_id(globalconf.L, -1, SIGNAL_ID("property::width"), 0);
+    if(c->geometry.height != old.height)
+        luaA_object_emit_signal_id(globalconf.L, -1, SIGNAL_ID("property::height"), 0);
+    lua_pop(globalconf.L, 1);
+}
+
+/** Resize client window.
+ * The sizes given as parameters are with titlebar and borders!
+ * \param c Client to resize.
+ * \param geometry New window geometry.
+ * \param hints Use size hints.
+ * \return true if an actual resize occurred.
+ */
+bool
+client_resize(client_t *c, area_t geometry, bool hints)
+{
+    area_t old = c->geometry;
+    bool resized;
+
+    /* Ignore all spurious enter/leave notify events */
+    client_ignore_enterleave_events();
+    resized = client_geometry_apply(c, geometry, hints);
+    client_restore_enterleave_events();
+
+    if(resized)
+        client_geometry_emit(c, old);
+
+    return resized;
+}
+
+/** Get the geometry a client would get from client_resize_batch().
+ * \param c The client.
+ * \param geometry The asked geometry, with titlebar and borders.
+ * \return The geometry the client would have.
+ */
+area_t
+client_geometry_fit(client_t *c, area_t geometry)
+{
+    area_t geometry_internal;
+
+    if(client_isfixed(c))
+    {
+        geometry.width = c->geometry.width;
+        geometry.height = c->geometry.height;
     }
 
-    return false;
+    if(!client_geometry_compute(c, &geometry, &geometry_internal, c->size_hints_honor))
+        return c->geometry;
+
+    return geometry;
+}
+
+/** Resize several clients in one go, as client:geometry() would.
+ * All windows are configured while enter and leave events are ignored once,
+ * then each client which actually changed emits its signals.
+ * \param clients The clients to resize.
+ * \param geometries The new geometries, with titlebar and borders. Each one
+ * is replaced by the geometry its client ends up with.
+ * \param n The number of clients.
+ */
+void
+client_resize_batch(client_t **clients, area_t *geometries, int n)
+{
+    area_t old[n];
+    bool resized[n];
+
+    client_ignore_enterleave_events();
+    for(int i = 0; i < n; i++)
+    {
+        client_t *c = clients[i];
+
+        old[i] = c->geometry;
+        if(client_isfixed(c))
+        {
+            geometries[i].width = c->geometry.width;
+            geometries[i].height = c->geometry.height;
+        }
+        resized[i] = client_geometry_apply(c, geometries[i], c->size_hints_honor);
+    }
+    client_restore_enterleave_events();
+
+    for(int i = 0; i < n; i++)
+    {
+        if(resized[i])
+            client_geometry_emit(clients[i], old[i]);
+        geometries[i] = clients[i]->geometry;
+    }
 }
 
 /** Set a client minimized, or not.
@@ -1268,6 +1387,7 @@ client_unmanage(client_t *c)
             client_array_remove(&globalconf.clients, elem);
             break;
         }
+    window_owner_unregister(c->window);
     stack_client_remove(c);
     for(int i = 0; i < tags->len; i++)
         untag_client(c, tags->tab[i]);
@@ -1439,6 +1559,7 @@ client_set_icon(lua_State *L, int cidx, int iidx)
     luaA_checkudata(L, iidx, &image_class);
     luaA_object_unref_item(L, cidx, c->icon);
     c->icon = luaA_object_ref_item(L, cidx, iidx);
+    c->icon_hash = 0;
     luaA_object_emit_signal(L, cidx < iidx ? cidx : cidx - 1, "property::icon", 0);
     /* execute hook */
     hook_property(c, "icon");
@@ -1868,38 +1989,376 @@ LUA_OBJECT_EXPORT_PROPERTY(client, client_t, opacity, lua_pushnumber)
 LUA_OBJECT_EXPORT_PROPERTY(client, client_t, border_width, lua_pushnumber)
 LUA_OBJECT_EXPORT_PROPERTY(client, client_t, border_color, luaA_pushxcolor)
 
+/** Shared memory segment client contents are captured into. */
+static struct
+{
+    /** True once the SHM extension presence has been checked */
+    bool checked;
+    /** True if the SHM extension can be used */
+    bool enabled;
+    /** True while an asynchronous capture is pending on the segment */
+    bool busy;
+    /** The segment as known by the X server */
+    xcb_shm_seg_t seg;
+    /** The segment data */
+    uint8_t *data;
+    /** The segment size */
+    size_t size;
+} client_content_shm;
+
+/** Buffer the captured pixels are converted into, reused across captures. */
+static struct
+{
+    uint32_t *data;
+    size_t size;
+} client_content_buffer;
+
+/** Asynchronous client content capture request. */
+typedef struct
+{
+    /** The captured area size */
+    uint16_t width, height;
+    /** The maximum size of the resulting image, 0 for unlimited */
+    int max_width, max_height;
+    /** True if the capture is done into the shared memory segment */
+    bool shm;
+    /** The request sequence number */
+    unsigned int sequence;
+    /** The function called with the resulting image */
+    int callback;
+} client_content_request_t;
+
+static void
+client_content_request_wipe(client_content_request_t *request)
+{
+    luaA_unregister(globalconf.L, &request->callback);
+}
+
+DO_ARRAY(client_content_request_t, client_content_request, client_content_request_wipe)
+
+/** Pending asynchronous captures. */
+static client_content_request_array_t client_content_requests;
+
+/** Make sure the shared memory segment is available and large enough.
+ * \param size The number of bytes needed.
+ * \return True if the segment can be used.
+ */
+static bool
+client_content_shm_reserve(size_t size)
+{
+    xcb_generic_error_t *error = NULL;
+    void *data;
+    int id;
+
+    if(!client_content_shm.checked)
+    {
+        const xcb_query_extension_reply_t *ext =
+            xcb_get_extension_data(globalconf.connection, &xcb_shm_id);
+        client_content_shm.checked = true;
+        client_content_shm.enabled = ext && ext->present;
+    }
+
+    if(!client_content_shm.enabled || client_content_shm.busy)
+        return false;
+
+    if(size <= client_content_shm.size)
+        return true;
+
+    if(client_content_shm.data)
+    {
+        xcb_shm_detach(globalconf.connection, client_content_shm.seg);
+        shmdt(client_content_shm.data);
+        client_content_shm.data = NULL;
+        client_content_shm.size = 0;
+    }
+
+    if((id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600)) < 0)
+    {
+        warn("cannot allocate shared memory segment: %s", strerror(errno));
+        client_content_shm.enabled = false;
+        return false;
+    }
+
+    data = shmat(id, NULL, 0);
+
+    if(data != (void *) -1)
+    {
+        client_content_shm.seg = xcb_generate_id(globalconf.connection);
+        error = xcb_request_check(globalconf.connection,
+                                  xcb_shm_attach_checked(globalconf.connection,
+                                                         client_content_shm.seg,
+                                                         id, false));
+    }
+
+    /* The segment is destroyed once both sides detached from it */
+    shmctl(id, IPC_RMID, NULL);
+
+    if(data == (void *) -1)
+    {
+        warn("cannot attach shared memory segment: %s", strerror(errno));
+        client_content_shm.enabled = false;
+        return false;
+    }
+
+    if(error)
+    {
+        /* Remote X server, most likely: stick to the socket */
+        p_delete(&error);
+        shmdt(data);
+        client_content_shm.enabled = false;
+        return false;
+    }
+
+    client_content_shm.data = data;
+    client_content_shm.size = size;
+
+    return true;
+}
+
+/** Convert captured pixels to an image and push it onto the stack.
+ * \param L The Lua VM state.
+ * \param depth The depth of the captured pixels.
+ * \param data The captured pixels, in Z pixmap format.
+ * \param len The length of data in bytes.
+ * \param width The captured area width.
+ * \param height The captured area height.
+ * \param max_width The maximum image width, 0 for unlimited.
+ * \param max_height The maximum image height, 0 for unlimited.
+ * \return The number of elements pushed on stack.
+ */
 static int
-luaA_client_get_content(lua_State *L, client_t *c)
+client_content_push(lua_State *L, uint8_t depth, uint8_t *data, size_t len,
+                    int width, int height, int max_width, int max_height)
 {
-    xcb_image_t *ximage = xcb_image_get(globalconf.connection,
-                                        c->window,
-                                        0, 0,
-                                        c->geometries.internal.width,
-                                        c->geometries.internal.height,
-                                        ~0, XCB_IMAGE_FORMAT_Z_PIXMAP);
-    int retval = 0;
+    xcb_image_t *ximage = NULL;
+    int iw = width, ih = height;
+    uint32_t *pixels;
+
+    if(depth < 24 || !width || !height)
+        return 0;
 
-    if(ximage)
+    /* Downscale to fit in the requested size, keeping the aspect ratio */
+    if(max_width > 0 && iw > max_width)
     {
-        if(ximage->bpp >= 24)
-        {
-            uint32_t *data = p_alloca(uint32_t, ximage->width * ximage->height);
+        ih = ih * max_width / iw;
+        iw = max_width;
+    }
+    if(max_height > 0 && ih > max_height)
+    {
+        iw = iw * max_height / ih;
+        ih = max_height;
+    }
+    iw = MAX(iw, 1);
+    ih = MAX(ih, 1);
+
+    if(client_content_buffer.size < (size_t) iw * ih)
+    {
+        client_content_buffer.size = (size_t) iw * ih;
+        p_realloc(&client_content_buffer.data, client_content_buffer.size);
+    }
+    pixels = client_content_buffer.data;
 
-            for(int y = 0; y < ximage->height; y++)
-                for(int x = 0; x < ximage->width; x++)
-                {
-                    data[y * ximage->width + x] = xcb_image_get_pixel(ximage, x, y);
-                    data[y * ximage->width + x] |= 0xff000000; /* set alpha to 0xff */
-                }
+    /* Native 32 bits pixels are read directly */
+#if AWESOME_IS_BIG_ENDIAN
+    if(len == (size_t) width * height * 4
+       && xcb_get_setup(globalconf.connection)->image_byte_order == XCB_IMAGE_ORDER_MSB_FIRST)
+#else
+    if(len == (size_t) width * height * 4
+       && xcb_get_setup(globalconf.connection)->image_byte_order == XCB_IMAGE_ORDER_LSB_FIRST)
+#endif
+    {
+        const uint32_t *src = (const uint32_t *) data;
 
-            retval = image_new_from_argb32(ximage->width, ximage->height, data);
+        if(iw == width && ih == height)
+            pixel_force_alpha(pixels, src, width * height);
+        else
+            for(int y = 0; y < ih; y++)
+            {
+                const uint32_t *line = src + (y * height / ih) * width;
+                for(int x = 0; x < iw; x++)
+                    pixels[y * iw + x] = line[x * width / iw] | 0xff000000;
+            }
+    }
+    else
+    {
+        ximage = xcb_image_create_native(globalconf.connection, width, height,
+                                         XCB_IMAGE_FORMAT_Z_PIXMAP, depth,
+                                         NULL, len, data);
+        if(!ximage || ximage->bpp < 24)
+        {
+            if(ximage)
+                xcb_image_destroy(ximage);
+            return 0;
         }
+
+        for(int y = 0; y < ih; y++)
+            for(int x = 0; x < iw; x++)
+                /* set alpha to 0xff */
+                pixels[y * iw + x] = xcb_image_get_pixel(ximage,
+                                                         x * width / iw,
+                                                         y * height / ih) | 0xff000000;
+
         xcb_image_destroy(ximage);
     }
 
+    return image_new_from_argb32(iw, ih, pixels);
+}
+
+/** Send a request capturing a client content.
+ * \param c The client.
+ * \param shm Set to true if the capture is done into the shared memory segment.
+ * \return The request sequence number.
+ */
+static unsigned int
+client_content_request(client_t *c, bool *shm)
+{
+    uint16_t width = c->geometries.internal.width;
+    uint16_t height = c->geometries.internal.height;
+
+    /* A Z pixmap never takes more than 4 bytes per pixel */
+    if((*shm = client_content_shm_reserve((size_t) width * height * 4)))
+        return xcb_shm_get_image(globalconf.connection, c->window,
+                                 0, 0, width, height, ~0,
+                                 XCB_IMAGE_FORMAT_Z_PIXMAP,
+                                 client_content_shm.seg, 0).sequence;
+
+    return xcb_get_image(globalconf.connection, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                         c->window, 0, 0, width, height, ~0).sequence;
+}
+
+/** Push the content of a capture reply onto the stack.
+ * \param L The Lua VM state.
+ * \param reply The reply.
+ * \param shm True if the capture was done into the shared memory segment.
+ * \param width The captured area width.
+ * \param height The captured area height.
+ * \param max_width The maximum image width, 0 for unlimited.
+ * \param max_height The maximum image height, 0 for unlimited.
+ * \return The number of elements pushed on stack.
+ */
+static int
+client_content_reply_push(lua_State *L, void *reply, bool shm,
+                          int width, int height, int max_width, int max_height)
+{
+    if(shm)
+    {
+        xcb_shm_get_image_reply_t *r = reply;
+        return client_content_push(L, r->depth, client_content_shm.data, r->size,
+                                   width, height, max_width, max_height);
+    }
+    else
+    {
+        xcb_get_image_reply_t *r = reply;
+        return client_content_push(L, r->depth, xcb_get_image_data(r),
+                                   xcb_get_image_data_length(r),
+                                   width, height, max_width, max_height);
+    }
+}
+
+/** Call the callbacks of the asynchronous captures which completed.
+ * This is called after the X events have been read.
+ */
+void
+client_content_check(void)
+{
+    for(int i = 0; i < client_content_requests.len;)
+    {
+        client_content_request_t request;
+        xcb_generic_error_t *error = NULL;
+        void *reply = NULL;
+
+        if(!xcb_poll_for_reply(globalconf.connection,
+                               client_content_requests.tab[i].sequence,
+                               &reply, &error))
+        {
+            i++;
+            continue;
+        }
+
+        /* Remove the request before running the callback, which may add new
+         * ones */
+        request = client_content_request_array_take(&client_content_requests, i);
+
+        if(request.shm)
+            client_content_shm.busy = false;
+
+        if(!reply || !client_content_reply_push(globalconf.L, reply, request.shm,
+                                                request.width, request.height,
+                                                request.max_width, request.max_height))
+            lua_pushnil(globalconf.L);
+
+        luaA_dofunction_from_registry(globalconf.L, request.callback, 1, 0);
+
+        client_content_request_wipe(&request);
+        p_delete(&reply);
+        p_delete(&error);
+    }
+}
+
+static int
+luaA_client_get_content(lua_State *L, client_t *c)
+{
+    xcb_generic_error_t *error = NULL;
+    unsigned int sequence;
+    void *reply;
+    bool shm;
+    int retval = 0;
+
+    sequence = client_content_request(c, &shm);
+
+    if(shm)
+        reply = xcb_shm_get_image_reply(globalconf.connection,
+                                        (xcb_shm_get_image_cookie_t) { sequence },
+                                        &error);
+    else
+        reply = xcb_get_image_reply(globalconf.connection,
+                                    (xcb_get_image_cookie_t) { sequence },
+                                    &error);
+
+    if(reply)
+        retval = client_content_reply_push(L, reply, shm,
+                                           c->geometries.internal.width,
+                                           c->geometries.internal.height,
+                                           0, 0);
+
+    p_delete(&reply);
+    p_delete(&error);
+
     return retval;
 }
 
+/** Capture a client content without blocking.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lvalue A client.
+ * \lparam A function called with the image, or nil on failure.
+ * \lparam An optional maximum width the image is downscaled to.
+ * \lparam An optional maximum height the image is downscaled to.
+ */
+static int
+luaA_client_content_async(lua_State *L)
+{
+    client_t *c = luaA_client_checkudata(L, 1);
+    client_content_request_t request = { .callback = LUA_REFNIL };
+
+    luaA_checkfunction(L, 2);
+    request.max_width = luaL_optnumber(L, 3, 0);
+    request.max_height = luaL_optnumber(L, 4, 0);
+    request.width = c->geometries.internal.width;
+    request.height = c->geometries.internal.height;
+    request.sequence = client_content_request(c, &request.shm);
+
+    if(request.shm)
+        client_content_shm.busy = true;
+
+    luaA_registerfct(L, 2, &request.callback);
+
+    client_content_request_array_append(&client_content_requests, request);
+
+    return 0;
+}
+
 static int
 luaA_client_get_type(lua_State *L, client_t *c)
 {
@@ -2136,9 +2595,15 @@ luaA_client_keys(lua_State *L)
     if(lua_gettop(L) == 2)
     {
         luaA_key_array_set(L, 1, 2, keys);
+        key_index_reset(&c->keys_index);
         luaA_object_emit_signal(L, 1, "property::keys", 0);
-        xcb_ungrab_key(globalconf.connection, XCB_GRAB_ANY, c->window, XCB_BUTTON_MASK_ANY);
-        window_grabkeys(c->window, keys);
+
+        key_grab_array_t grabs;
+        key_grab_array_init(&grabs);
+        key_array_grabs(keys, &grabs);
+        window_grabkeys(c->window, &c->keys_grabs, &grabs);
+        key_grab_array_wipe(&c->keys_grabs);
+        c->keys_grabs = grabs;
     }
 
     return luaA_key_array_get(L, 1, keys);
@@ -2215,6 +2680,7 @@ client_class_setup(lua_State *L)
         { "raise", luaA_client_raise },
         { "lower", luaA_client_lower },
         { "redraw", luaA_client_redraw },
+        { "content_async", luaA_client_content_async },
         { "unmanage", luaA_client_unmanage },
         { "__gc", luaA_client_gc },
         { NULL, NULL }
@@ -27,6 +27,8 @@
 #include "strut.h"
 #include "draw.h"
 #include "banning.h"
+#include "property.h"
+#include "tagmask.h"
 #include "common/luaobject.h"
 
 #define CLIENT_SELECT_INPUT_EVENT_MASK (XCB_EVENT_MASK_STRUCTURE_NOTIFY \
@@ -128,14 +130,22 @@ struct client_t
     screen_t *screen;
     /** Client physical screen */
     int phys_screen;
+    /** Tags the client is tagged with */
+    tag_mask_t tags;
     /** Titlebar */
     wibox_t *titlebar;
     /** Button bindings */
     button_array_t buttons;
     /** Key bindings */
     key_array_t keys;
+    /** Index of the key bindings */
+    key_index_t keys_index;
+    /** Key combinations grabbed on the window */
+    key_grab_array_t keys_grabs;
     /** Icon */
     image_t *icon;
+    /** Hash of the _NET_WM_ICON content the icon was made from, 0 if none */
+    uint64_t icon_hash;
     /** Size hints */
     xcb_size_hints_t size_hints;
     bool size_hints_honor;
@@ -165,9 +175,11 @@ client_t * client_getbywin(xcb_window_t);
 void client_ban(client_t *);
 void client_ban_unfocus(client_t *);
 void client_unban(client_t *);
-void client_manage(xcb_window_t, xcb_get_geometry_reply_t *, int, bool);
+void client_manage(xcb_window_t, xcb_get_geometry_reply_t *, property_cookies_t *, int, bool);
 area_t client_geometry_hints(client_t *, area_t);
 bool client_resize(client_t *, area_t, bool);
+area_t client_geometry_fit(client_t *, area_t);
+void client_resize_batch(client_t **, area_t *, int);
 void client_unmanage(client_t *);
 void client_kill(client_t *);
 void client_set_sticky(lua_State *, int, bool);
@@ -204,6 +216,7 @@ bool client_hasproto(client_t *, xcb_atom_t);
 void client_set_focus(client_t *, bool);
 void client_ignore_enterleave_events(void);
 void client_restore_enterleave_events(void);
+void client_content_check(void);
 void client_class_setup(lua_State *);
 
 static inline void
@@ -34,10 +34,6 @@ struct lua_class_property
     lua_class_propfunc_t newindex;
 };
 
-DO_ARRAY(lua_class_t *, lua_class, DO_NOTHING)
-
-static lua_class_array_t luaA_classes;
-
 /** Convert a object to a udata if possible.
  * \param L The Lua VM state.
  * \param ud The index.
@@ -81,14 +77,17 @@ luaA_checkudata(lua_State *L, int ud, lua_class_t *class)
 lua_class_t *
 luaA_class_get(lua_State *L, int idx)
 {
-    int type = lua_type(L, idx);
+    lua_class_t *class = NULL;
 
-    if(type == LUA_TUSERDATA)
-        foreach(class, luaA_classes)
-            if(luaA_toudata(L, idx, *class))
-                return *class;
+    if(lua_type(L, idx) == LUA_TUSERDATA && lua_getmetatable(L, idx))
+    {
+        /* The registry maps each class metatable to its class. */
+        lua_rawget(L, LUA_REGISTRYINDEX);
+        class = lua_touserdata(L, -1);
+        lua_pop(L, 1);
+    }
 
-    return NULL;
+    return class;
 }
 
 /** Enhanced version of lua_typename that recognizes setup Lua classes.
@@ -167,6 +166,10 @@ luaA_class_setup(lua_State *L, lua_class_t *class,
     /* Duplicate the metatable */
     lua_pushvalue(L, -2);
     lua_rawset(L, LUA_REGISTRYINDEX);
+    /* And the class with the metatable as key, to find it back */
+    lua_pushvalue(L, -1);
+    lua_pushlightuserdata(L, class);
+    lua_rawset(L, LUA_REGISTRYINDEX);
 
     lua_pushvalue(L, -1);           /* dup metatable                      2 */
     lua_setfield(L, -2, "__index"); /* metatable.__index = metatable      1 */
@@ -181,8 +184,6 @@ luaA_class_setup(lua_State *L, lua_class_t *class,
     class->name = name;
     class->index_miss_property = index_miss_property;
     class->newindex_miss_property = newindex_miss_property;
-
-    lua_class_array_append(&luaA_classes, class);
 }
 
 void
@@ -211,6 +212,13 @@ luaA_class_emit_signal(lua_State *L, lua_class_t *lua_class,
     signal_object_emit(L, &lua_class->signals, name, nargs);
 }
 
+void
+luaA_class_emit_signal_id(lua_State *L, lua_class_t *lua_class,
+                          unsigned long id, int nargs)
+{
+    signal_object_emit_id(L, &lua_class->signals, id, nargs);
+}
+
 /** Try to use the metatable of an object.
  * \param L The Lua VM state.
  * \param idxobj The index of the object.
@@ -247,6 +255,8 @@ lua_class_property_array_getbyid(lua_class_property_array_t *arr,
 }
 
 /** Get a property of a object.
+ * Properties found are cached in a table keyed by field name, so that looking
+ * them up again only costs a hash probe on the interned Lua string.
  * \param L The Lua VM state.
  * \param lua_class The Lua class.
  * \param fieldidx The index of the field name.
@@ -255,12 +265,42 @@ lua_class_property_array_getbyid(lua_class_property_array_t *arr,
 static lua_class_property_t *
 luaA_class_property_get(lua_State *L, lua_class_t *lua_class, int fieldidx)
 {
+    lua_class_property_t *prop;
+    bool cacheable = lua_type(L, fieldidx) == LUA_TSTRING;
+
+    if(!lua_class->properties_cache)
+    {
+        lua_newtable(L);
+        lua_class->properties_cache = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+    else if(cacheable)
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, lua_class->properties_cache);
+        lua_pushvalue(L, fieldidx);
+        lua_rawget(L, -2);
+        prop = lua_touserdata(L, -1);
+        lua_pop(L, 2);
+        if(prop)
+            return prop;
+    }
+
     /* Lookup the property using token */
     size_t len;
     const char *attr = luaL_checklstring(L, fieldidx, &len);
     awesome_token_t token = a_tokenize(attr, len);
 
-    return lua_class_property_array_getbyid(&lua_class->properties, token);
+    prop = lua_class_property_array_getbyid(&lua_class->properties, token);
+
+    if(prop && cacheable)
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, lua_class->properties_cache);
+        lua_pushvalue(L, fieldidx);
+        lua_pushlightuserdata(L, prop);
+        lua_rawset(L, -3);
+        lua_pop(L, 1);
+    }
+
+    return prop;
 }
 
 /** Generic index meta function for objects.
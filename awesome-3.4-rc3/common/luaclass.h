@@ -52,8 +52,10 @@ typedef struct
     signal_array_t signals;
     /** Allocator for creating new objects of that class */
     lua_class_allocator_t allocator;
-    /** Class properties */
+    /** Class properties, which must all be added before any lookup */
     lua_class_property_array_t properties;
+    /** Registry reference to the properties cache, indexed by name */
+    int properties_cache;
     /** Function to call when a indexing an unknown property */
     lua_class_propfunc_t index_miss_property;
     /** Function to call when a indexing an unknown property */
@@ -66,6 +68,7 @@ lua_class_t * luaA_class_get(lua_State *, int);
 void luaA_class_add_signal(lua_State *, lua_class_t *, const char *, int);
 void luaA_class_remove_signal(lua_State *, lua_class_t *, const char *, int);
 void luaA_class_emit_signal(lua_State *, lua_class_t *, const char *, int);
+void luaA_class_emit_signal_id(lua_State *, lua_class_t *, unsigned long, int);
 
 void luaA_openlib(lua_State *, const char *, const struct luaL_reg[], const struct luaL_reg[]);
 void luaA_class_setup(lua_State *, lua_class_t *, const char *, lua_class_allocator_t,
@@ -181,77 +181,255 @@ luaA_object_remove_signal(lua_State *L, int oud,
     lua_remove(L, ud);
 }
 
+/** A signal emission waiting to be dispatched */
+typedef struct
+{
+    /** The signal array the signal is emitted on */
+    signal_array_t *signals;
+    /** The signal id */
+    unsigned long id;
+    /** The object owning the signal array, referenced, or NULL */
+    void *object;
+    /** Emission order */
+    unsigned long seq;
+} signal_pending_t;
+
+static int
+signal_pending_cmp(const void *a, const void *b)
+{
+    const signal_pending_t *x = a, *y = b;
+    if(x->signals != y->signals)
+        return x->signals > y->signals ? 1 : -1;
+    return x->id > y->id ? 1 : (x->id < y->id ? -1 : 0);
+}
+
+static int
+signal_pending_seq_cmp(const void *a, const void *b)
+{
+    const signal_pending_t *x = a, *y = b;
+    return x->seq > y->seq ? 1 : (x->seq < y->seq ? -1 : 0);
+}
+
+DO_BARRAY(signal_pending_t, signal_pending, DO_NOTHING, signal_pending_cmp)
+
+static int
+signal_id_cmp(const void *a, const void *b)
+{
+    const unsigned long *x = a, *y = b;
+    return *x > *y ? 1 : (*x < *y ? -1 : 0);
+}
+
+DO_BARRAY(unsigned long, signal_id, DO_NOTHING, signal_id_cmp)
+
+/** Signals which emissions are coalesced, sorted by id */
+static signal_id_array_t signals_coalesced;
+/** Coalesced emissions waiting to be dispatched */
+static signal_pending_array_t signals_pending;
+/** Counter used to dispatch pending signals in emission order */
+static unsigned long signals_pending_seq;
+
+/** Set whether the emissions of a signal should be coalesced.
+ * A coalesced signal emitted without arguments is not dispatched at once:
+ * it is queued, and emitted only once per object until
+ * signal_object_emit_pending() is called.
+ * \param name The signal name.
+ * \param coalesce True to coalesce the signal, false to emit it directly.
+ */
 void
-signal_object_emit(lua_State *L, signal_array_t *arr, const char *name, int nargs)
+signal_coalesce(const char *name, bool coalesce)
 {
-    signal_t *sigfound = signal_array_getbyid(arr,
-                                              a_strhash((const unsigned char *) name));
+    unsigned long id = signal_id(name);
+    unsigned long *found = signal_id_array_lookup(&signals_coalesced, &id);
+
+    if(coalesce && !found)
+        signal_id_array_insert(&signals_coalesced, id);
+    else if(!coalesce && found)
+        signal_id_array_remove(&signals_coalesced, found);
+}
+
+/** Queue a signal emission if the signal is coalesced.
+ * \param L The Lua VM state.
+ * \param arr The signal array.
+ * \param id The signal id.
+ * \param oud The index of the object owning the array on the stack, or 0.
+ * \param nargs The number of arguments of the emission.
+ * \return True if the emission has been queued, false if it must be done now.
+ */
+static bool
+signal_object_defer(lua_State *L, signal_array_t *arr, unsigned long id, int oud, int nargs)
+{
+    if(nargs || !signal_id_array_lookup(&signals_coalesced, &id))
+        return false;
+
+    signal_pending_t pending = { .signals = arr, .id = id };
 
-    if(sigfound)
+    /* already queued, collapse it */
+    if(signal_pending_array_lookup(&signals_pending, &pending))
+        return true;
+
+    if(oud)
     {
-        int nbfunc = sigfound->sigfuncs.len;
-        luaL_checkstack(L, lua_gettop(L) + nbfunc + nargs + 1, "too much signal");
-        /* Push all functions and then execute, because this list can change
-         * while executing funcs. */
-        foreach(func, sigfound->sigfuncs)
+        lua_pushvalue(L, oud);
+        pending.object = luaA_object_ref(L, -1);
+    }
+    pending.seq = signals_pending_seq++;
+    signal_pending_array_insert(&signals_pending, pending);
+
+    return true;
+}
+
+/** Call the functions connected to a signal.
+ * \param L The Lua VM state.
+ * \param sigfound The signal.
+ * \param nargs The number of arguments to pass to the called functions.
+ */
+static void
+signal_object_emit_found(lua_State *L, signal_t *sigfound, int nargs)
+{
+    int nbfunc = signal_func_count(sigfound);
+    luaL_checkstack(L, lua_gettop(L) + nbfunc + nargs + 1, "too much signal");
+    /* Push all functions and then execute, because this list can change
+     * while executing funcs. */
+    foreach(func, sigfound->sigfuncs)
+        if(*func)
             luaA_object_push(L, (void *) *func);
 
-        for(int i = 0; i < nbfunc; i++)
-        {
-            /* push all args */
-            for(int j = 0; j < nargs; j++)
-                lua_pushvalue(L, - nargs - nbfunc + i);
-            /* push first function */
+    for(int i = 0; i < nbfunc; i++)
+    {
+        /* push all args */
+        for(int j = 0; j < nargs; j++)
             lua_pushvalue(L, - nargs - nbfunc + i);
-            /* remove this first function */
-            lua_remove(L, - nargs - nbfunc - 1 + i);
-            luaA_dofunction(L, nargs, 0);
-        }
+        /* push first function */
+        lua_pushvalue(L, - nargs - nbfunc + i);
+        /* remove this first function */
+        lua_remove(L, - nargs - nbfunc - 1 + i);
+        luaA_dofunction(L, nargs, 0);
     }
+}
+
+/** Emit a signal from its id.
+ * \param L The Lua VM state.
+ * \param arr The signal array.
+ * \param id The signal id, see signal_id().
+ * \param nargs The number of arguments to pass to the called functions.
+ */
+void
+signal_object_emit_id(lua_State *L, signal_array_t *arr, unsigned long id, int nargs)
+{
+    signal_t *sigfound = signal_array_getbyid(arr, id);
+
+    if(sigfound && !signal_object_defer(L, arr, id, 0, nargs))
+        signal_object_emit_found(L, sigfound, nargs);
+
     /* remove args */
     lua_pop(L, nargs);
 }
 
-/** Emit a signal to an object.
+void
+signal_object_emit(lua_State *L, signal_array_t *arr, const char *name, int nargs)
+{
+    signal_object_emit_id(L, arr, signal_id(name), nargs);
+}
+
+/** Call the functions connected to a signal of an object.
  * \param L The Lua VM state.
  * \param oud The object index on the stack.
- * \param name The name of the signal.
+ * \param sigfound The signal.
+ * \param nargs The number of arguments to pass to the called functions.
+ */
+static void
+luaA_object_emit_found(lua_State *L, int oud, signal_t *sigfound, int nargs)
+{
+    int oud_abs = luaA_absindex(L, oud);
+    int nbfunc = signal_func_count(sigfound);
+    luaL_checkstack(L, lua_gettop(L) + nbfunc + nargs + 2, "too much signal");
+    /* Push all functions and then execute, because this list can change
+     * while executing funcs. */
+    foreach(func, sigfound->sigfuncs)
+        if(*func)
+            luaA_object_push_item(L, oud_abs, (void *) *func);
+
+    for(int i = 0; i < nbfunc; i++)
+    {
+        /* push object */
+        lua_pushvalue(L, oud_abs);
+        /* push all args */
+        for(int j = 0; j < nargs; j++)
+            lua_pushvalue(L, - nargs - nbfunc - 1 + i);
+        /* push first function */
+        lua_pushvalue(L, - nargs - nbfunc - 1 + i);
+        /* remove this first function */
+        lua_remove(L, - nargs - nbfunc - 2 + i);
+        luaA_dofunction(L, nargs + 1, 0);
+    }
+}
+
+/** Emit a signal to an object from the signal id.
+ * \param L The Lua VM state.
+ * \param oud The object index on the stack.
+ * \param id The signal id, see signal_id().
  * \param nargs The number of arguments to pass to the called functions.
  */
 void
-luaA_object_emit_signal(lua_State *L, int oud,
-                        const char *name, int nargs)
+luaA_object_emit_signal_id(lua_State *L, int oud,
+                           unsigned long id, int nargs)
 {
     int oud_abs = luaA_absindex(L, oud);
     lua_object_t *obj = lua_touserdata(L, oud);
     if(!obj)
         luaL_error(L, "trying to emit signal on non-object");
-    signal_t *sigfound = signal_array_getbyid(&obj->signals,
-                                              a_strhash((const unsigned char *) name));
-    if(sigfound)
+    signal_t *sigfound = signal_array_getbyid(&obj->signals, id);
+    if(sigfound && !signal_object_defer(L, &obj->signals, id, oud_abs, nargs))
+        luaA_object_emit_found(L, oud_abs, sigfound, nargs);
+    lua_pop(L, nargs);
+}
+
+/** Emit a signal to an object.
+ * \param L The Lua VM state.
+ * \param oud The object index on the stack.
+ * \param name The name of the signal.
+ * \param nargs The number of arguments to pass to the called functions.
+ */
+void
+luaA_object_emit_signal(lua_State *L, int oud,
+                        const char *name, int nargs)
+{
+    luaA_object_emit_signal_id(L, oud, signal_id(name), nargs);
+}
+
+/** Dispatch the coalesced signals queued since the last call.
+ * Signals emitted by the called functions are dispatched too.
+ * \param L The Lua VM state.
+ */
+void
+signal_object_emit_pending(lua_State *L)
+{
+    while(signals_pending.len)
     {
-        int nbfunc = sigfound->sigfuncs.len;
-        luaL_checkstack(L, lua_gettop(L) + nbfunc + nargs + 2, "too much signal");
-        /* Push all functions and then execute, because this list can change
-         * while executing funcs. */
-        foreach(func, sigfound->sigfuncs)
-            luaA_object_push_item(L, oud_abs, (void *) *func);
+        signal_pending_array_t queue = signals_pending;
 
-        for(int i = 0; i < nbfunc; i++)
+        signal_pending_array_init(&signals_pending);
+        qsort(queue.tab, queue.len, sizeof(*queue.tab), signal_pending_seq_cmp);
+
+        foreach(pending, queue)
         {
-            /* push object */
-            lua_pushvalue(L, oud_abs);
-            /* push all args */
-            for(int j = 0; j < nargs; j++)
-                lua_pushvalue(L, - nargs - nbfunc - 1 + i);
-            /* push first function */
-            lua_pushvalue(L, - nargs - nbfunc - 1 + i);
-            /* remove this first function */
-            lua_remove(L, - nargs - nbfunc - 2 + i);
-            luaA_dofunction(L, nargs + 1, 0);
+            /* functions may have been removed since it was queued */
+            signal_t *sigfound = signal_array_getbyid(pending->signals, pending->id);
+
+            if(pending->object)
+            {
+                luaA_object_push(L, pending->object);
+                if(sigfound)
+                    luaA_object_emit_found(L, -1, sigfound, 0);
+                lua_pop(L, 1);
+                luaA_object_unref(L, pending->object);
+            }
+            else if(sigfound)
+                signal_object_emit_found(L, sigfound, 0);
         }
+
+        signal_pending_array_wipe(&queue);
     }
-    lua_pop(L, nargs);
 }
 
 int
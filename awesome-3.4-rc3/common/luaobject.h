@@ -149,10 +149,14 @@ luaA_object_push(lua_State *L, void *pointer)
 }
 
 void signal_object_emit(lua_State *, signal_array_t *, const char *, int);
+void signal_object_emit_id(lua_State *, signal_array_t *, unsigned long, int);
+void signal_object_emit_pending(lua_State *);
+void signal_coalesce(const char *, bool);
 
 void luaA_object_add_signal(lua_State *, int, const char *, int);
 void luaA_object_remove_signal(lua_State *, int, const char *, int);
 void luaA_object_emit_signal(lua_State *, int, const char *, int);
+void luaA_object_emit_signal_id(lua_State *, int, unsigned long, int);
 
 int luaA_object_add_signal_simple(lua_State *);
 int luaA_object_remove_signal_simple(lua_State *);
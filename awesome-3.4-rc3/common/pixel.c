@@ -0,0 +1,179 @@
+/*
+ * pixel.c - pixel conversion functions
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* All pixels are native endian 32 bits ARGB values. The SSE2 versions work
+ * on 4 pixels at once and give exactly the same results as the plain ones,
+ * which handle the remaining pixels. */
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "common/pixel.h"
+
+/** Multiply a color component by an alpha value, both in [0, 255].
+ * \param c The color component.
+ * \param a The alpha value.
+ * \return c * a / 255, rounded.
+ */
+static inline uint32_t
+pixel_mul(uint32_t c, uint32_t a)
+{
+    uint32_t t = c * a + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+/** Convert pixels to the premultiplied alpha form cairo wants.
+ * \param dst Where to store the converted pixels.
+ * \param src The pixels to convert.
+ * \param len The number of pixels.
+ */
+void
+pixel_premultiply(uint32_t *dst, const uint32_t *src, int len)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16(128);
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+    for(; i + 4 <= len; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i *) (src + i));
+        /* 2 pixels in each, one 16 bits lane per component */
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        __m128i hi = _mm_unpackhi_epi8(p, zero);
+        /* the alpha of each pixel in all its lanes */
+        __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)),
+                                          _MM_SHUFFLE(3, 3, 3, 3));
+        __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)),
+                                          _MM_SHUFFLE(3, 3, 3, 3));
+
+        lo = _mm_add_epi16(_mm_mullo_epi16(lo, alo), half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_add_epi16(_mm_mullo_epi16(hi, ahi), half);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+
+        /* Put the original alpha back */
+        p = _mm_or_si128(_mm_andnot_si128(alpha, _mm_packus_epi16(lo, hi)),
+                         _mm_and_si128(alpha, p));
+        _mm_storeu_si128((__m128i *) (dst + i), p);
+    }
+#endif
+
+    for(; i < len; i++)
+    {
+        uint32_t a = src[i] >> 24;
+        dst[i] = (a << 24)
+            | (pixel_mul((src[i] >> 16) & 0xff, a) << 16)
+            | (pixel_mul((src[i] >>  8) & 0xff, a) <<  8)
+            |  pixel_mul( src[i]        & 0xff, a);
+    }
+}
+
+/** Make pixels opaque.
+ * \param dst Where to store the opaque pixels.
+ * \param src The pixels.
+ * \param len The number of pixels.
+ */
+void
+pixel_force_alpha(uint32_t *dst, const uint32_t *src, int len)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i alpha = _mm_set1_epi32(0xff000000);
+
+    for(; i + 4 <= len; i += 4)
+        _mm_storeu_si128((__m128i *) (dst + i),
+                         _mm_or_si128(_mm_loadu_si128((const __m128i *) (src + i)), alpha));
+#endif
+
+    for(; i < len; i++)
+        dst[i] = src[i] | 0xff000000;
+}
+
+/** Reverse the bits of a byte.
+ * \param b The byte.
+ * \return The reversed byte.
+ */
+static inline uint8_t
+pixel_reverse_bits(uint8_t b)
+{
+    b = (b & 0xf0) >> 4 | (b & 0x0f) << 4;
+    b = (b & 0xcc) >> 2 | (b & 0x33) << 2;
+    return (b & 0xaa) >> 1 | (b & 0x55) << 1;
+}
+
+/** Convert pixels to a line of a bitmap: a pixel is set if the mean of its
+ * color components, ignoring alpha, is at least 127.
+ * \param dst The bitmap line, (len + 7) / 8 bytes long.
+ * \param src The pixels.
+ * \param len The number of pixels.
+ * \param msb_first True if the first pixel of a byte is its most
+ * significant bit.
+ */
+void
+pixel_threshold(uint8_t *dst, const uint32_t *src, int len, bool msb_first)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i mask = _mm_set1_epi32(0xff);
+    /* (r + g + b) / 3 >= 127 is r + g + b > 380 */
+    const __m128i threshold = _mm_set1_epi32(380);
+
+    for(; i + 8 <= len; i += 8)
+    {
+        int bits = 0;
+
+        for(int j = 0; j < 8; j += 4)
+        {
+            __m128i p = _mm_loadu_si128((const __m128i *) (src + i + j));
+            __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(_mm_srli_epi32(p, 16), mask),
+                                                      _mm_and_si128(_mm_srli_epi32(p, 8), mask)),
+                                        _mm_and_si128(p, mask));
+            bits |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(sum, threshold))) << j;
+        }
+
+        dst[i / 8] = msb_first ? pixel_reverse_bits(bits) : bits;
+    }
+#endif
+
+    for(; i < len; i += 8)
+    {
+        int bits = 0;
+
+        for(int j = 0; j < 8 && i + j < len; j++)
+        {
+            uint32_t sum = ((src[i + j] >> 16) & 0xff)
+                + ((src[i + j] >> 8) & 0xff)
+                + (src[i + j] & 0xff);
+            if(sum > 380)
+                bits |= 1 << j;
+        }
+
+        dst[i / 8] = msb_first ? pixel_reverse_bits(bits) : bits;
+    }
+}
+
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
@@ -0,0 +1,33 @@
+/*
+ * pixel.h - pixel conversion functions header
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AWESOME_COMMON_PIXEL_H
+#define AWESOME_COMMON_PIXEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void pixel_premultiply(uint32_t *, const uint32_t *, int);
+void pixel_force_alpha(uint32_t *, const uint32_t *, int);
+void pixel_threshold(uint8_t *, const uint32_t *, int, bool);
+
+#endif
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
@@ -0,0 +1,221 @@
+/*
+ * common/signal.c - Signal handling functions
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdint.h>
+
+#include "common/signal.h"
+
+/** Find the bucket of a signal, or the free bucket where it would go.
+ * \param arr The signal array, with at least one free bucket.
+ * \param id The signal id.
+ * \return The bucket.
+ */
+static signal_t *
+signal_array_bucket(signal_array_t *arr, unsigned long id)
+{
+    unsigned long mask = arr->size - 1;
+
+    for(unsigned long i = id & mask;; i = (i + 1) & mask)
+        if(!arr->tab[i].used || arr->tab[i].id == id)
+            return &arr->tab[i];
+}
+
+/** Get a signal from a signal array.
+ * \param arr The signal array.
+ * \param id The signal id.
+ * \return The signal, or NULL if no function was ever connected to it.
+ */
+signal_t *
+signal_array_getbyid(signal_array_t *arr, unsigned long id)
+{
+    signal_t *sig;
+
+    if(!arr->size)
+        return NULL;
+
+    sig = signal_array_bucket(arr, id);
+    return sig->used ? sig : NULL;
+}
+
+/** Get a signal from a signal array, adding it if needed.
+ * \param arr The signal array.
+ * \param id The signal id.
+ * \return The signal.
+ */
+static signal_t *
+signal_array_get(signal_array_t *arr, unsigned long id)
+{
+    signal_t *sig = signal_array_getbyid(arr, id);
+
+    if(sig)
+        return sig;
+
+    /* Keep at least half of the buckets free */
+    if((arr->len + 1) * 2 > arr->size)
+    {
+        signal_t *old = arr->tab;
+        int oldsize = arr->size;
+
+        arr->size = oldsize ? oldsize * 2 : 8;
+        arr->tab = p_new(signal_t, arr->size);
+
+        for(int i = 0; i < oldsize; i++)
+            if(old[i].used)
+                *signal_array_bucket(arr, old[i].id) = old[i];
+
+        p_delete(&old);
+    }
+
+    sig = signal_array_bucket(arr, id);
+    sig->used = true;
+    sig->id = id;
+    arr->len++;
+
+    return sig;
+}
+
+/** Wipe a signal array.
+ * \param arr The signal array.
+ */
+void
+signal_array_wipe(signal_array_t *arr)
+{
+    for(int i = 0; i < arr->size; i++)
+        if(arr->tab[i].used)
+        {
+            cptr_array_wipe(&arr->tab[i].sigfuncs);
+            p_delete(&arr->tab[i].slots);
+        }
+    p_delete(&arr->tab);
+    arr->len = arr->size = 0;
+}
+
+/** Get the first bucket to look at for a function.
+ * \param sig The signal.
+ * \param ref The function.
+ * \return The bucket index.
+ */
+static inline int
+signal_func_hash(signal_t *sig, const void *ref)
+{
+    uintptr_t h = (uintptr_t) ref;
+    return (h ^ (h >> 9)) & (sig->nslots - 1);
+}
+
+/** Record the position of a function of a signal.
+ * \param sig The signal, with at least one free slot bucket.
+ * \param ref The function.
+ * \param position Its position in sigfuncs.
+ */
+static void
+signal_func_index(signal_t *sig, const void *ref, int position)
+{
+    int i = signal_func_hash(sig, ref);
+
+    while(sig->slots[i].ref)
+        i = (i + 1) & (sig->nslots - 1);
+
+    sig->slots[i].ref = ref;
+    sig->slots[i].position = position;
+}
+
+/** Drop the holes left by removed functions and record the positions of
+ * the functions again.
+ * \param sig The signal.
+ */
+static void
+signal_func_reindex(signal_t *sig)
+{
+    int len = 0;
+
+    for(int i = 0; i < sig->sigfuncs.len; i++)
+        if(sig->sigfuncs.tab[i])
+            sig->sigfuncs.tab[len++] = sig->sigfuncs.tab[i];
+    sig->sigfuncs.len = len;
+    sig->removed = 0;
+
+    /* Leave room to add as many functions before the next rebuild */
+    sig->nslots = 8;
+    while(sig->nslots < len * 4)
+        sig->nslots *= 2;
+    p_delete(&sig->slots);
+    sig->slots = p_new(signal_func_slot_t, sig->nslots);
+
+    for(int i = 0; i < len; i++)
+        signal_func_index(sig, sig->sigfuncs.tab[i], i);
+}
+
+/** Add a signal inside a signal array.
+ * You are in charge of reference counting.
+ * \param arr The signal array.
+ * \param name The signal name.
+ * \param ref The reference to add.
+ */
+void
+signal_add(signal_array_t *arr, const char *name, const void *ref)
+{
+    signal_t *sig = signal_array_get(arr, signal_id(name));
+
+    cptr_array_append(&sig->sigfuncs, ref);
+
+    /* Slots of removed functions are only freed by a rebuild */
+    if(sig->sigfuncs.len * 2 > sig->nslots)
+        signal_func_reindex(sig);
+    else
+        signal_func_index(sig, ref, sig->sigfuncs.len - 1);
+}
+
+/** Remove a signal inside a signal array.
+ * The first connected occurrence of the function is removed, and the
+ * others keep their order.
+ * You are in charge of reference counting.
+ * \param arr The signal array.
+ * \param name The signal name.
+ * \param ref The reference to remove.
+ */
+void
+signal_remove(signal_array_t *arr, const char *name, const void *ref)
+{
+    signal_t *sig = signal_array_getbyid(arr, signal_id(name));
+    signal_func_slot_t *found = NULL;
+
+    if(!sig || !sig->nslots)
+        return;
+
+    for(int i = signal_func_hash(sig, ref);
+        sig->slots[i].ref;
+        i = (i + 1) & (sig->nslots - 1))
+        if(sig->slots[i].ref == ref && sig->slots[i].position >= 0
+           && (!found || sig->slots[i].position < found->position))
+            found = &sig->slots[i];
+
+    if(!found)
+        return;
+
+    sig->sigfuncs.tab[found->position] = NULL;
+    found->position = -1;
+
+    /* Compact once half of the functions are holes */
+    if(++sig->removed * 2 > sig->sigfuncs.len)
+        signal_func_reindex(sig);
+}
+
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
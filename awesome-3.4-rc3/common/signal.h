@@ -27,75 +27,91 @@
 
 DO_ARRAY(const void *, cptr, DO_NOTHING)
 
+/** Where a function is in the functions of a signal */
+typedef struct
+{
+    /** The function, NULL for a free bucket */
+    const void *ref;
+    /** Its position in sigfuncs, -1 once removed */
+    int position;
+} signal_func_slot_t;
+
 typedef struct
 {
     unsigned long id;
+    /** True if this bucket holds a signal */
+    bool used;
+    /** Connected functions in connection order, NULL where removed */
     cptr_array_t sigfuncs;
+    /** Number of NULL left in sigfuncs */
+    int removed;
+    /** Positions of the functions, open addressing by function */
+    signal_func_slot_t *slots;
+    /** Number of buckets in slots, a power of 2 */
+    int nslots;
 } signal_t;
 
-static inline int
-signal_cmp(const void *a, const void *b)
+/** Signals by id, open addressing */
+typedef struct
 {
-    const signal_t *x = a, *y = b;
-    return x->id > y->id ? 1 : (x->id < y->id ? -1 : 0);
-}
+    /** Buckets */
+    signal_t *tab;
+    /** Number of signals */
+    int len;
+    /** Number of buckets, a power of 2 */
+    int size;
+} signal_array_t;
 
-static inline void
-signal_wipe(signal_t *sig)
+/** Get the id of a signal from its name.
+ * \param name The signal name.
+ * \return The signal id.
+ */
+static inline unsigned long
+signal_id(const char *name)
 {
-    cptr_array_wipe(&sig->sigfuncs);
+    return a_strhash((const unsigned char *) name);
 }
 
-DO_BARRAY(signal_t, signal, signal_wipe, signal_cmp)
-
-static inline signal_t *
-signal_array_getbyid(signal_array_t *arr, unsigned long id)
-{
-    signal_t sig = { .id = id };
-    return signal_array_lookup(arr, &sig);
-}
+/** Get the id of a constant signal name, hashing it only the first time
+ * this call site is reached.
+ * \param name The signal name, a string literal.
+ */
+#define SIGNAL_ID(name)                                                         \
+    ({                                                                          \
+        static unsigned long signal_id_cache_;                                  \
+        if(!signal_id_cache_)                                                   \
+            signal_id_cache_ = signal_id(name);                                 \
+        signal_id_cache_;                                                       \
+    })
 
-/** Add a signal inside a signal array.
- * You are in charge of reference counting.
- * \param arr The signal array.
- * \param name The signal name.
- * \param ref The reference to add.
+/** Get the number of functions connected to a signal.
+ * \param sig The signal.
+ * \return The number of functions.
  */
-static inline void
-signal_add(signal_array_t *arr, const char *name, const void *ref)
+static inline int
+signal_func_count(signal_t *sig)
 {
-    unsigned long tok = a_strhash((const unsigned char *) name);
-    signal_t *sigfound = signal_array_getbyid(arr, tok);
-    if(sigfound)
-        cptr_array_append(&sigfound->sigfuncs, ref);
-    else
-    {
-        signal_t sig = { .id = tok };
-        cptr_array_append(&sig.sigfuncs, ref);
-        signal_array_insert(arr, sig);
-    }
+    return sig->sigfuncs.len - sig->removed;
 }
 
-/** Remove a signal inside a signal array.
- * You are in charge of reference counting.
- * \param arr The signal array.
- * \param name The signal name.
- * \param ref The reference to remove.
+/** Get the first function connected to a signal.
+ * \param sig The signal.
+ * \return The function, or NULL if there is none.
  */
-static inline void
-signal_remove(signal_array_t *arr, const char *name, const void *ref)
+static inline const void *
+signal_func_first(signal_t *sig)
 {
-    signal_t *sigfound = signal_array_getbyid(arr,
-                                              a_strhash((const unsigned char *) name));
-    if(sigfound)
-        foreach(func, sigfound->sigfuncs)
-            if(ref == *func)
-            {
-                cptr_array_remove(&sigfound->sigfuncs, func);
-                break;
-            }
+    foreach(func, sig->sigfuncs)
+        if(*func)
+            return *func;
+    return NULL;
 }
 
+signal_t *signal_array_getbyid(signal_array_t *, unsigned long);
+void signal_array_wipe(signal_array_t *);
+void signal_add(signal_array_t *, const char *, const void *);
+void signal_remove(signal_array_t *, const char *, const void *);
+
 #endif
 
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
@@ -320,10 +320,10 @@ a_dbus_process_request(DBusConnection *dbus_connection, DBusMessage *msg)
     {
         signal_t *sig = signal_array_getbyid(&dbus_signals,
                                              a_strhash((const unsigned char *) interface));
-        if(sig)
+        /* there can be only ONE handler to send reply */
+        void *func = sig ? (void *) signal_func_first(sig) : NULL;
+        if(func)
         {
-            /* there can be only ONE handler to send reply */
-            void *func = (void *) sig->sigfuncs.tab[0];
 
             int n = lua_gettop(globalconf.L) - nargs;
 
@@ -706,7 +706,7 @@ luaA_dbus_add_signal(lua_State *L)
     luaA_checkfunction(L, 2);
     signal_t *sig = signal_array_getbyid(&dbus_signals,
                                          a_strhash((const unsigned char *) name));
-    if(sig)
+    if(sig && signal_func_count(sig))
         luaA_warn(L, "cannot add signal %s on D-Bus, already existing", name);
     else
         signal_add(&dbus_signals, name, luaA_object_ref(L, 2));
@@ -119,30 +119,116 @@ draw_text_context_init(draw_text_context_t *data, const char *str, ssize_t slen)
 /** Initialize a new draw context.
  * \param d The draw context to initialize.
  * \param phys_screen Physical screen id.
- * \param width Width.
- * \param height Height.
+ * \param width Width, before rotation.
+ * \param height Height, before rotation.
+ * \param orientation The rotation applied when drawing to the pixmap.
  * \param px Pixmap object to store.
  * \param fg Foreground color.
  * \param bg Background color.
  */
 void
 draw_context_init(draw_context_t *d, int phys_screen,
-                  int width, int height, xcb_pixmap_t px,
-                  const xcolor_t *fg, const xcolor_t *bg)
+                  int width, int height, orientation_t orientation,
+                  xcb_pixmap_t px, const xcolor_t *fg, const xcolor_t *bg)
 {
     d->phys_screen = phys_screen;
     d->width = width;
     d->height = height;
+    d->orientation = orientation;
     d->pixmap = px;
-    d->surface = cairo_xcb_surface_create(globalconf.connection,
-                                          px, globalconf.screens.tab[phys_screen].visual,
-                                          width, height);
+    switch(orientation)
+    {
+      case South:
+      case North:
+        d->surface = cairo_xcb_surface_create(globalconf.connection,
+                                              px, globalconf.screens.tab[phys_screen].visual,
+                                              height, width);
+        break;
+      case East:
+        d->surface = cairo_xcb_surface_create(globalconf.connection,
+                                              px, globalconf.screens.tab[phys_screen].visual,
+                                              width, height);
+        break;
+    }
     d->cr = cairo_create(d->surface);
-    d->layout = pango_cairo_create_layout(d->cr);
+    /* Everything is drawn rotated, straight to the pixmap */
+    switch(orientation)
+    {
+      case South:
+        cairo_translate(d->cr, height, 0);
+        cairo_rotate(d->cr, M_PI_2);
+        break;
+      case North:
+        cairo_translate(d->cr, 0, width);
+        cairo_rotate(d->cr, - M_PI_2);
+        break;
+      case East:
+        break;
+    }
     d->fg = *fg;
     d->bg = *bg;
 };
 
+/** Convert an area of a draw context to pixmap coordinates.
+ * \param ctx The draw context.
+ * \param area The area, before rotation.
+ * \return The area in the pixmap.
+ */
+area_t
+draw_area_to_pixmap(draw_context_t *ctx, area_t area)
+{
+    area_t r = area;
+
+    switch(ctx->orientation)
+    {
+      case South:
+        r.x = ctx->height - AREA_BOTTOM(area);
+        r.y = area.x;
+        r.width = area.height;
+        r.height = area.width;
+        break;
+      case North:
+        r.x = area.y;
+        r.y = ctx->width - AREA_RIGHT(area);
+        r.width = area.height;
+        r.height = area.width;
+        break;
+      case East:
+        break;
+    }
+
+    return r;
+}
+
+/** Get the layout of a text, creating it on first use.
+ * The layout keeps its text and attributes for the lifetime of the text
+ * context, so Pango only shapes it again when the font, the size or the
+ * modes it is set up with change.
+ * \param data Draw text context data.
+ * \return The layout.
+ */
+static PangoLayout *
+draw_text_layout(draw_text_context_t *data)
+{
+    if(!data->layout)
+    {
+        /* The layout gets its own Pango context, which is made to match the
+         * target of each draw with pango_cairo_update_layout() */
+        cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+        cairo_t *cr = cairo_create(surface);
+        data->layout = pango_cairo_create_layout(cr);
+        cairo_destroy(cr);
+        cairo_surface_destroy(surface);
+        pango_layout_set_text(data->layout, data->text, data->len);
+        pango_layout_set_attributes(data->layout, data->attr_list);
+    }
+
+    /* Pango ignores this unless the font changed */
+    pango_layout_set_font_description(data->layout, globalconf.font->desc);
+
+    return data->layout;
+}
+
 /** Draw text into a draw context.
  * \param ctx Draw context  to draw to.
  * \param data Draw text context data.
@@ -157,17 +243,20 @@ draw_text(draw_context_t *ctx, draw_text_context_t *data,
           PangoEllipsizeMode ellip, PangoWrapMode wrap,
           alignment_t align, alignment_t valign, area_t area)
 {
-    pango_layout_set_text(ctx->layout, data->text, data->len);
-    pango_layout_set_width(ctx->layout,
-                           pango_units_from_double(area.width));
-    pango_layout_set_height(ctx->layout, pango_units_from_double(area.height));
-    pango_layout_set_ellipsize(ctx->layout, ellip);
-    pango_layout_set_wrap(ctx->layout, wrap);
-    pango_layout_set_attributes(ctx->layout, data->attr_list);
-    pango_layout_set_font_description(ctx->layout, globalconf.font->desc);
+    if(data->len <= 0)
+        return;
+
+    PangoLayout *layout = draw_text_layout(data);
+
+    /* Setting unchanged values does not invalidate the layout */
+    pango_layout_set_width(layout, pango_units_from_double(area.width));
+    pango_layout_set_height(layout, pango_units_from_double(area.height));
+    pango_layout_set_ellipsize(layout, ellip);
+    pango_layout_set_wrap(layout, wrap);
+    pango_cairo_update_layout(ctx->cr, layout);
 
     PangoRectangle ext;
-    pango_layout_get_pixel_extents(ctx->layout, NULL, &ext);
+    pango_layout_get_pixel_extents(layout, NULL, &ext);
 
     /* Not enough space, draw nothing */
     if(ext.width > area.width || ext.height > area.height)
@@ -204,8 +293,7 @@ draw_text(draw_context_t *ctx, draw_text_context_t *data,
                           ctx->fg.green / 65535.0,
                           ctx->fg.blue / 65535.0,
                           ctx->fg.alpha / 65535.0);
-    pango_cairo_update_layout(ctx->cr, ctx->layout);
-    pango_cairo_show_layout(ctx->cr, ctx->layout);
+    pango_cairo_show_layout(ctx->cr, layout);
 }
 
 /** Setup color-source for cairo (gradient or mono).
@@ -503,7 +591,6 @@ static void
 draw_image_from_argb_data(draw_context_t *ctx, int x, int y, int w, int h,
                           double ratio, unsigned char *data)
 {
-    cairo_t *cr;
     cairo_surface_t *source;
 
     source = cairo_image_surface_create_for_data(data, CAIRO_FORMAT_ARGB32, w, h,
@@ -512,13 +599,14 @@ draw_image_from_argb_data(draw_context_t *ctx, int x, int y, int w, int h,
 #else
                                                  cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, w));
 #endif
-    cr = cairo_create(ctx->surface);
-    cairo_scale(cr, ratio, ratio);
-    cairo_set_source_surface(cr, source, x / ratio, y / ratio);
+    /* Use the context state, for its rotation and clip */
+    cairo_save(ctx->cr);
+    cairo_scale(ctx->cr, ratio, ratio);
+    cairo_set_source_surface(ctx->cr, source, x / ratio, y / ratio);
 
-    cairo_paint(cr);
+    cairo_paint(ctx->cr);
 
-    cairo_destroy(cr);
+    cairo_restore(ctx->cr);
     cairo_surface_destroy(source);
 }
 
@@ -532,86 +620,60 @@ draw_image_from_argb_data(draw_context_t *ctx, int x, int y, int w, int h,
 void
 draw_image(draw_context_t *ctx, int x, int y, double ratio, image_t *image)
 {
-    draw_image_from_argb_data(ctx, x, y, image_getwidth(image), image_getheight(image), ratio, image_getdata(image));
-}
-
-/** Rotate a pixmap.
- * \param ctx Draw context to draw with.
- * \param src Drawable to draw from.
- * \param dest Drawable to draw to.
- * \param src_w Drawable width.
- * \param src_h Drawable height.
- * \param dest_w Drawable width.
- * \param dest_h Drawable height.
- * \param angle angle to rotate.
- * \param tx Translate to this x coordinate.
- * \param ty Translate to this y coordinate.
- */
-void
-draw_rotate(draw_context_t *ctx,
-            xcb_pixmap_t src, xcb_pixmap_t dest,
-            int src_w, int src_h,
-            int dest_w, int dest_h,
-            double angle, int tx, int ty)
-{
-    cairo_surface_t *surface, *source;
-    cairo_t *cr;
-
-    surface = cairo_xcb_surface_create(globalconf.connection, dest,
-                                       globalconf.screens.tab[ctx->phys_screen].visual,
-                                       dest_w, dest_h);
-    source = cairo_xcb_surface_create(globalconf.connection, src,
-                                      globalconf.screens.tab[ctx->phys_screen].visual,
-                                      src_w, src_h);
-    cr = cairo_create (surface);
-
-    cairo_translate(cr, tx, ty);
-    cairo_rotate(cr, angle);
+    cairo_surface_t *source = image_getsurface(image, ctx->surface, ctx->phys_screen);
 
-    cairo_set_source_surface(cr, source, 0.0, 0.0);
-    cairo_paint(cr);
+    /* Not in the server-side cache, send the pixels */
+    if(!source)
+    {
+        draw_image_from_argb_data(ctx, x, y, image_getwidth(image), image_getheight(image), ratio, image_getdata(image));
+        return;
+    }
 
-    cairo_destroy(cr);
-    cairo_surface_destroy(source);
-    cairo_surface_destroy(surface);
+    cairo_save(ctx->cr);
+    cairo_scale(ctx->cr, ratio, ratio);
+    cairo_set_source_surface(ctx->cr, source, x / ratio, y / ratio);
+    cairo_paint(ctx->cr);
+    cairo_restore(ctx->cr);
 }
 
 /** Return the width and height of a text in pixel.
+ * The size is measured once per text and font, so the layout used by
+ * draw_text() keeps the size of the drawn area.
  * \param data The draw context text data.
  * \return Text height and width.
  */
 area_t
 draw_text_extents(draw_text_context_t *data)
 {
-    cairo_surface_t *surface;
-    cairo_t *cr;
     PangoLayout *layout;
     PangoRectangle ext;
-    xcb_screen_t *s = xutil_screen_get(globalconf.connection, globalconf.default_screen);
+    int width, height;
     area_t geom = { 0, 0, 0, 0 };
 
     if(data->len <= 0)
         return geom;
 
-    surface = cairo_xcb_surface_create(globalconf.connection,
-                                       globalconf.default_screen,
-                                       globalconf.screens.tab[0].visual,
-                                       s->width_in_pixels,
-                                       s->height_in_pixels);
-
-    cr = cairo_create(surface);
-    layout = pango_cairo_create_layout(cr);
-    pango_layout_set_text(layout, data->text, data->len);
-    pango_layout_set_attributes(layout, data->attr_list);
-    pango_layout_set_font_description(layout, globalconf.font->desc);
+    if(data->extents_font
+       && pango_font_description_equal(data->extents_font, globalconf.font->desc))
+        return data->extents;
+
+    layout = draw_text_layout(data);
+    width = pango_layout_get_width(layout);
+    height = pango_layout_get_height(layout);
+    pango_layout_set_width(layout, -1);
+    pango_layout_set_height(layout, -1);
     pango_layout_get_pixel_extents(layout, NULL, &ext);
-    g_object_unref(layout);
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
+    pango_layout_set_width(layout, width);
+    pango_layout_set_height(layout, height);
 
     geom.width = ext.width;
     geom.height = ext.height;
 
+    if(data->extents_font)
+        pango_font_description_free(data->extents_font);
+    data->extents_font = pango_font_description_copy(globalconf.font->desc);
+    data->extents = geom;
+
     return geom;
 }
 
@@ -70,18 +70,21 @@ struct area_t
 typedef struct
 {
     xcb_pixmap_t pixmap;
+    /** Size of the drawing area, before rotation */
     uint16_t width;
     uint16_t height;
+    /** Rotation from the drawing area to the pixmap */
+    orientation_t orientation;
     int phys_screen;
     cairo_t *cr;
     cairo_surface_t *surface;
-    PangoLayout *layout;
     xcolor_t fg;
     xcolor_t bg;
 } draw_context_t;
 
-void draw_context_init(draw_context_t *, int, int, int,
+void draw_context_init(draw_context_t *, int, int, int, orientation_t,
                        xcb_pixmap_t, const xcolor_t *, const xcolor_t *);
+area_t draw_area_to_pixmap(draw_context_t *, area_t);
 
 /** Wipe a draw context.
  * \param ctx The draw_context_t to wipe.
@@ -89,11 +92,6 @@ void draw_context_init(draw_context_t *, int, int, int,
 static inline void
 draw_context_wipe(draw_context_t *ctx)
 {
-    if(ctx->layout)
-    {
-        g_object_unref(ctx->layout);
-        ctx->layout = NULL;
-    }
     if(ctx->surface)
     {
         cairo_surface_destroy(ctx->surface);
@@ -134,6 +132,12 @@ typedef struct
     PangoAttrList *attr_list;
     char *text;
     ssize_t len;
+    /** Layout of the text, kept until the text changes */
+    PangoLayout *layout;
+    /** Size of the text on a single unbounded line */
+    area_t extents;
+    /** Font extents was measured with, NULL if not measured yet */
+    PangoFontDescription *extents_font;
 } draw_text_context_t;
 
 bool draw_text_context_init(draw_text_context_t *, const char *, ssize_t);
@@ -148,7 +152,6 @@ void draw_graph(draw_context_t *, area_t, int *, int *, int, position_t, vector_
 void draw_graph_line(draw_context_t *, area_t, int *, int, position_t, vector_t,
                      const color_t *, const color_t *, const color_t *);
 void draw_image(draw_context_t *, int, int, double, image_t *);
-void draw_rotate(draw_context_t *, xcb_drawable_t, xcb_drawable_t, int, int, int, int, double, int, int);
 area_t draw_text_extents(draw_text_context_t *);
 alignment_t draw_align_fromstr(const char *, ssize_t);
 const char *draw_align_tostr(alignment_t);
@@ -160,6 +163,10 @@ draw_text_context_wipe(draw_text_context_t *pdata)
     {
         if(pdata->attr_list)
             pango_attr_list_unref(pdata->attr_list);
+        if(pdata->layout)
+            g_object_unref(pdata->layout);
+        if(pdata->extents_font)
+            pango_font_description_free(pdata->extents_font);
         p_delete(&pdata->text);
     }
 }
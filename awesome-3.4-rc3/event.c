@@ -39,6 +39,7 @@
 #include "luaa.h"
 #include "systray.h"
 #include "screen.h"
+#include "selection.h"
 #include "common/atoms.h"
 #include "common/xutil.h"
 
@@ -81,16 +82,6 @@
         lua_pop(globalconf.L, nargs); \
     }
 
-static bool
-event_key_match(xcb_key_press_event_t *ev, keyb_t *k, void *data)
-{
-    assert(data);
-    xcb_keysym_t keysym = *(xcb_keysym_t *) data;
-    return (((k->keycode && ev->detail == k->keycode)
-             || (k->keysym && keysym == k->keysym))
-            && (k->modifiers == XCB_BUTTON_MASK_ANY || k->modifiers == ev->state));
-}
-
 static bool
 event_button_match(xcb_button_press_event_t *ev, button_t *b, void *data)
 {
@@ -99,7 +90,58 @@ event_button_match(xcb_button_press_event_t *ev, button_t *b, void *data)
 }
 
 DO_EVENT_HOOK_CALLBACK(button_t, button, XCB_BUTTON, button_array_t, event_button_match)
-DO_EVENT_HOOK_CALLBACK(keyb_t, key, XCB_KEY, key_array_t, event_key_match)
+
+/** Emit the press or release signal of the keys matching a key event.
+ * \param ev The event.
+ * \param arr The key array.
+ * \param index The index of the key array.
+ * \param oud The index of the object owning the keys on the stack, 0 for none.
+ * \param nargs The number of arguments to pass to the signal handlers.
+ * \param keysym The keysym of the event, without modifiers.
+ */
+static void
+event_key_callback(xcb_key_press_event_t *ev,
+                   key_array_t *arr,
+                   key_index_t *index,
+                   int oud,
+                   int nargs,
+                   xcb_keysym_t keysym)
+{
+    const char *signal;
+
+    /* Mask the SendEvent bit, a synthetic press is still a press */
+    switch(XCB_EVENT_RESPONSE_TYPE(ev))
+    {
+      case XCB_KEY_PRESS:
+        signal = "press";
+        break;
+      case XCB_KEY_RELEASE:
+        signal = "release";
+        break;
+      default:
+        lua_pop(globalconf.L, nargs);
+        return;
+    }
+
+    int abs_oud = oud < 0 ? ((lua_gettop(globalconf.L) + 1) + oud) : oud;
+    int positions[MAX(arr->len * 2, 1)];
+    int item_matching = key_index_lookup(index, arr, ev->detail, keysym, ev->state, positions);
+
+    for(int i = 0; i < item_matching; i++)
+        if(oud)
+            luaA_object_push_item(globalconf.L, abs_oud, arr->tab[positions[i]]);
+        else
+            luaA_object_push(globalconf.L, arr->tab[positions[i]]);
+
+    for(; item_matching > 0; item_matching--)
+    {
+        for(int i = 0; i < nargs; i++)
+            lua_pushvalue(globalconf.L, - nargs - item_matching);
+        luaA_object_emit_signal(globalconf.L, - nargs - 1, signal, nargs);
+        lua_pop(globalconf.L, 1);
+    }
+    lua_pop(globalconf.L, nargs);
+}
 
 /** Handle an event with mouse grabber if needed
  * \param x The x coordinate.
@@ -580,10 +622,10 @@ event_handle_key(void *data __attribute__ ((unused)),
         if((c = client_getbywin(ev->event)))
         {
             luaA_object_push(globalconf.L, c);
-            event_key_callback(ev, &c->keys, -1, 1, &keysym);
+            event_key_callback(ev, &c->keys, &c->keys_index, -1, 1, keysym);
         }
         else
-            event_key_callback(ev, &globalconf.keys, 0, 0, &keysym);
+            event_key_callback(ev, &globalconf.keys, &globalconf.keys_index, 0, 0, keysym);
     }
 
     return 0;
@@ -604,6 +646,7 @@ event_handle_maprequest(void *data __attribute__ ((unused)),
     xcb_get_window_attributes_reply_t *wa_r;
     xcb_get_geometry_cookie_t geom_c;
     xcb_get_geometry_reply_t *geom_r;
+    property_cookies_t prop_c;
 
     wa_c = xcb_get_window_attributes_unchecked(connection, ev->window);
 
@@ -633,16 +676,18 @@ event_handle_maprequest(void *data __attribute__ ((unused)),
     else
     {
         geom_c = xcb_get_geometry_unchecked(connection, ev->window);
+        property_cookies_send(ev->window, &prop_c);
 
         if(!(geom_r = xcb_get_geometry_reply(connection, geom_c, NULL)))
         {
+            property_cookies_discard(&prop_c);
             ret = -1;
             goto bailout;
         }
 
         phys_screen = xutil_root2screen(connection, geom_r->root);
 
-        client_manage(ev->window, geom_r, phys_screen, false);
+        client_manage(ev->window, geom_r, &prop_c, phys_screen, false);
 
         p_delete(&geom_r);
     }
@@ -772,22 +817,29 @@ event_handle_mappingnotify(void *data,
                             &globalconf.shiftlockmask, &globalconf.capslockmask,
                             &globalconf.modeswitchmask);
 
+        /* keysyms may now be on other keycodes */
+        key_keycodes_invalidate();
+
         int nscreen = xcb_setup_roots_length(xcb_get_setup(connection));
+        key_grab_array_t none;
+        key_grab_array_init(&none);
 
         /* regrab everything */
+        key_array_grabs(&globalconf.keys, &globalconf.keys_grabs);
         for(int phys_screen = 0; phys_screen < nscreen; phys_screen++)
         {
             xcb_screen_t *s = xutil_screen_get(globalconf.connection, phys_screen);
             /* yes XCB_BUTTON_MASK_ANY is also for grab_key even if it's look weird */
             xcb_ungrab_key(connection, XCB_GRAB_ANY, s->root, XCB_BUTTON_MASK_ANY);
-            window_grabkeys(s->root, &globalconf.keys);
+            window_grabkeys(s->root, &none, &globalconf.keys_grabs);
         }
 
         foreach(_c, globalconf.clients)
         {
             client_t *c = *_c;
+            key_array_grabs(&c->keys, &c->keys_grabs);
             xcb_ungrab_key(connection, XCB_GRAB_ANY, c->window, XCB_BUTTON_MASK_ANY);
-            window_grabkeys(c->window, &c->keys);
+            window_grabkeys(c->window, &none, &c->keys_grabs);
         }
     }
 
@@ -828,6 +880,7 @@ void a_xcb_set_event_handlers(void)
     xcb_event_set_client_message_handler(&globalconf.evenths, event_handle_clientmessage, NULL);
     xcb_event_set_mapping_notify_handler(&globalconf.evenths, event_handle_mappingnotify, NULL);
     xcb_event_set_reparent_notify_handler(&globalconf.evenths, event_handle_reparentnotify, NULL);
+    xcb_event_set_selection_notify_handler(&globalconf.evenths, selection_handle_selectionnotify, NULL);
 
     /* check for randr extension */
     randr_query = xcb_get_extension_data(globalconf.connection, &xcb_randr_id);
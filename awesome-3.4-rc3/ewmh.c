@@ -32,6 +32,8 @@
 #include "widget.h"
 #include "wibox.h"
 #include "luaa.h"
+#include "image.h"
+#include "property.h"
 #include "common/atoms.h"
 #include "common/buffer.h"
 #include "common/xutil.h"
@@ -630,6 +632,9 @@ ewmh_process_client_strut(client_t *c, xcb_get_property_reply_t *strut_r)
     p_delete(&mstrut_r);
 }
 
+/** Size of the icons read from _NET_WM_ICON, 0 to keep the largest one. */
+static int ewmh_icon_size = 32;
+
 /** Send request to get NET_WM_ICON (EWMH)
  * \param w The window.
  * \return The cookie associated with the request.
@@ -641,11 +646,76 @@ ewmh_window_icon_get_unchecked(xcb_window_t w)
                                     _NET_WM_ICON, CARDINAL, 0, UINT32_MAX);
 }
 
+/** Check if an icon size is closer to the wanted one than another.
+ * The smallest icon not smaller than the wanted size is the best, since it
+ * only has to be downscaled; otherwise the largest one is.
+ * \param size The candidate icon size.
+ * \param best The size of the best icon so far.
+ * \return True if the candidate is better.
+ */
+static bool
+ewmh_icon_size_isbetter(uint32_t size, uint32_t best)
+{
+    if(!ewmh_icon_size || best < (uint32_t) ewmh_icon_size)
+        return size > best;
+    return size >= (uint32_t) ewmh_icon_size && size < best;
+}
+
+/** Compute the hash of an icon content.
+ * \param width The icon width.
+ * \param height The icon height.
+ * \param data The icon data.
+ * \return A 64 bits FNV-1a hash, never 0.
+ */
+static uint64_t
+ewmh_icon_hash(uint32_t width, uint32_t height, const uint32_t *data)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const uint8_t *p = (const uint8_t *) data;
+    const uint8_t *end = p + (size_t) width * height * sizeof(uint32_t);
+
+    /* The target size is part of the key since it changes the result */
+    hash = (hash ^ width) * 1099511628211ULL;
+    hash = (hash ^ height) * 1099511628211ULL;
+    hash = (hash ^ (uint32_t) ewmh_icon_size) * 1099511628211ULL;
+
+    for(; p < end; p++)
+        hash = (hash ^ *p) * 1099511628211ULL;
+
+    return hash ? hash : 1;
+}
+
+/** Push a copy of the icon of a client already using the given icon content.
+ * Each client gets its own image, so drawing on the icon of one client does
+ * not change the others.
+ * \param hash The icon content hash.
+ * \return The number of elements pushed on stack.
+ */
+static int
+ewmh_icon_push_copy(uint64_t hash)
+{
+    foreach(c, globalconf.clients)
+        if((*c)->icon && (*c)->icon_hash == hash
+           && !image_ismodified((*c)->icon))
+            return image_new_copy((*c)->icon);
+
+    return 0;
+}
+
+/** Push the icon of a NET_WM_ICON property.
+ * The property may hold several icons: the one closest to the configured icon
+ * size is used, and downscaled to it. Clients with identical icons get a copy
+ * of the already downscaled image.
+ * \param r The property reply.
+ * \param hash Filled with the hash of the icon content.
+ * \return The number of elements pushed on stack.
+ */
 int
-ewmh_window_icon_from_reply(xcb_get_property_reply_t *r)
+ewmh_window_icon_from_reply(xcb_get_property_reply_t *r, uint64_t *hash)
 {
-    uint32_t *data;
-    uint64_t len;
+    uint32_t *data, *best = NULL;
+    uint32_t left, best_size = 0;
+    int width, height;
 
     if(!r || r->type != CARDINAL || r->format != 32 || r->length < 2)
         return 0;
@@ -654,28 +724,83 @@ ewmh_window_icon_from_reply(xcb_get_property_reply_t *r)
     if (!data)
         return 0;
 
-    /* Check that the property is as long as it should be, handling integer
-     * overflow. <uint32_t> times <another uint32_t casted to uint64_t> always
-     * fits into an uint64_t and thus this multiplication cannot overflow.
-     */
-    len = data[0] * (uint64_t) data[1];
-    if (!data[0] || !data[1] || len > r->length - 2)
+    for(left = r->length; left >= 2;)
+    {
+        /* Check that the property is as long as it should be, handling
+         * integer overflow. <uint32_t> times <another uint32_t casted to
+         * uint64_t> always fits into an uint64_t and thus this multiplication
+         * cannot overflow.
+         */
+        uint64_t len = data[0] * (uint64_t) data[1];
+        if (!data[0] || !data[1] || len > left - 2)
+            break;
+
+        if(!best || ewmh_icon_size_isbetter(MAX(data[0], data[1]), best_size))
+        {
+            best = data;
+            best_size = MAX(data[0], data[1]);
+        }
+
+        left -= len + 2;
+        data += len + 2;
+    }
+
+    if(!best)
         return 0;
 
-    return image_new_from_argb32(data[0], data[1], data + 2);
+    *hash = ewmh_icon_hash(best[0], best[1], best + 2);
+
+    if(ewmh_icon_push_copy(*hash))
+        return 1;
+
+    width = best[0];
+    height = best[1];
+
+    if(ewmh_icon_size && best_size > (uint32_t) ewmh_icon_size)
+    {
+        width = MAX(1, (uint64_t) width * ewmh_icon_size / best_size);
+        height = MAX(1, (uint64_t) height * ewmh_icon_size / best_size);
+    }
+
+    return image_new_from_argb32_scaled(best[0], best[1], best + 2, width, height);
 }
 
 /** Get NET_WM_ICON.
  * \param cookie The cookie.
+ * \param hash Filled with the hash of the icon content.
  * \return The number of elements on stack.
  */
 int
-ewmh_window_icon_get_reply(xcb_get_property_cookie_t cookie)
+ewmh_window_icon_get_reply(xcb_get_property_cookie_t cookie, uint64_t *hash)
 {
     xcb_get_property_reply_t *r = xcb_get_property_reply(globalconf.connection, cookie, NULL);
-    int ret = ewmh_window_icon_from_reply(r);
+    int ret = ewmh_window_icon_from_reply(r, hash);
     p_delete(&r);
     return ret;
 }
 
+/** Get the size of the icons read from NET_WM_ICON.
+ * \return The size, 0 if the largest icons are kept.
+ */
+int
+ewmh_icon_size_get(void)
+{
+    return ewmh_icon_size;
+}
+
+/** Set the size of the icons read from NET_WM_ICON, and reload them.
+ * \param size The size, 0 to keep the largest icons.
+ */
+void
+ewmh_icon_size_set(int size)
+{
+    if(size == ewmh_icon_size)
+        return;
+
+    ewmh_icon_size = size;
+
+    foreach(c, globalconf.clients)
+        property_update_net_wm_icon(*c, NULL);
+}
+
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
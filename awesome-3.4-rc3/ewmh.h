@@ -40,8 +40,10 @@ void ewmh_update_workarea(int);
 void ewmh_process_client_strut(client_t *, xcb_get_property_reply_t *);
 void ewmh_update_strut(xcb_window_t, strut_t *);
 xcb_get_property_cookie_t ewmh_window_icon_get_unchecked(xcb_window_t);
-int ewmh_window_icon_from_reply(xcb_get_property_reply_t *);
-int ewmh_window_icon_get_reply(xcb_get_property_cookie_t);
+int ewmh_window_icon_from_reply(xcb_get_property_reply_t *, uint64_t *);
+int ewmh_window_icon_get_reply(xcb_get_property_cookie_t, uint64_t *);
+int ewmh_icon_size_get(void);
+void ewmh_icon_size_set(int);
 
 #endif
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
@@ -48,6 +48,50 @@ ARRAY_TYPE(screen_t, screen)
 ARRAY_TYPE(client_t *, client)
 ARRAY_TYPE(wibox_t *, wibox)
 
+/** A window and the objects owning it */
+typedef struct
+{
+    /** The window */
+    xcb_window_t window;
+    /** The client owning the window, if any */
+    client_t *client;
+    /** The wibox owning the window, if any */
+    wibox_t *wibox;
+} window_owner_t;
+
+static inline int
+window_owner_cmp(const void *a, const void *b)
+{
+    const window_owner_t *x = a, *y = b;
+    return x->window > y->window ? 1 : (x->window < y->window ? -1 : 0);
+}
+
+DO_BARRAY(window_owner_t, window_owner, DO_NOTHING, window_owner_cmp)
+
+/** A widget or widgets table and the wiboxes containing it */
+typedef struct
+{
+    /** The item, as returned by lua_topointer() */
+    const void *item;
+    /** The wiboxes containing the item */
+    cptr_array_t wiboxes;
+} wibox_item_t;
+
+static inline int
+wibox_item_cmp(const void *a, const void *b)
+{
+    const wibox_item_t *x = a, *y = b;
+    return x->item > y->item ? 1 : (x->item < y->item ? -1 : 0);
+}
+
+static inline void
+wibox_item_wipe(wibox_item_t *witem)
+{
+    cptr_array_wipe(&witem->wiboxes);
+}
+
+DO_BARRAY(wibox_item_t, wibox_item, wibox_item_wipe, wibox_item_cmp)
+
 /** Main configuration structure */
 typedef struct
 {
@@ -67,6 +111,10 @@ typedef struct
     bool xinerama_is_active;
     /** Root window key bindings */
     key_array_t keys;
+    /** Index of the root window key bindings */
+    key_index_t keys_index;
+    /** Key combinations grabbed on the root windows */
+    key_grab_array_t keys_grabs;
     /** Root window mouse bindings */
     button_array_t buttons;
     /** Modifiers masks */
@@ -123,6 +171,8 @@ typedef struct
     struct ev_loop *loop;
     /** The timeout after which we need to stop select() */
     struct ev_timer timer;
+    /** The timeout after which deferred wibox redraws are due */
+    struct ev_timer redraw_timer;
     /** The key grabber function */
     int keygrabber;
     /** The mouse pointer grabber function */
@@ -133,6 +183,10 @@ typedef struct
     bool client_need_stack_refresh;
     /** Wiboxes */
     wibox_array_t wiboxes;
+    /** Index of the windows we own or manage, sorted by window id */
+    window_owner_array_t windows;
+    /** Index of the widgets and widgets tables, sorted by item */
+    wibox_item_array_t wibox_items;
     /** The startup notification display struct */
     SnDisplay *sndisplay;
 } awesome_t;
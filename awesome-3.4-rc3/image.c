@@ -22,11 +22,13 @@
 #include <xcb/xcb_image.h>
 
 #include <Imlib2.h>
+#include <cairo.h>
 
 #include "globalconf.h"
 #include "config.h"
 #include "luaa.h"
 #include "common/luaobject.h"
+#include "common/pixel.h"
 
 struct image
 {
@@ -38,17 +40,163 @@ struct image
     /** Flag telling if the image is up to date or needs computing before
      * drawing */
     bool isupdated;
+    /** Server-side copies of the image by physical screen, NULL where there
+     * is none */
+    struct image_surface_t **surfaces;
+    /** Rectangles covering the pixels set when used as a shape, in YX
+     * banded order */
+    xcb_rectangle_t *shape;
+    /** Number of rectangles in shape */
+    int shape_len;
+    /** Flag telling if the shape rectangles are up to date */
+    bool shape_isupdated;
+    /** Flag telling if the image has been modified since its creation */
+    bool ismodified;
 };
 
 LUA_OBJECT_FUNCS(image_class, image_t, image)
 
+/** Default memory budget of the server-side image cache, in bytes. */
+#define IMAGE_CACHE_SIZE (8 * 1024 * 1024)
+
+/** An image uploaded to the X server */
+typedef struct image_surface_t image_surface_t;
+
+/** A server-side copy of an image */
+struct image_surface_t
+{
+    /** The image */
+    image_t *image;
+    /** The physical screen it has been uploaded for */
+    int phys_screen;
+    /** The server-side copy */
+    cairo_surface_t *surface;
+    /** Its size in bytes */
+    size_t size;
+    /** Neighbours in the cache, the most recently drawn first */
+    image_surface_t *prev, *next;
+};
+
+/** Server-side copies of the images, so drawing them does not send their
+ * pixels to the X server each time. Each image holds its own copies, this
+ * only keeps track of their order of use to evict them. */
+static struct
+{
+    /** The most recently drawn copy */
+    image_surface_t *first;
+    /** The least recently drawn copy */
+    image_surface_t *last;
+    /** Memory used by the copies */
+    size_t size;
+    /** Memory budget */
+    size_t max;
+} image_cache = { .max = IMAGE_CACHE_SIZE };
+
+/** Unlink a copy from the image cache.
+ * \param surface The copy.
+ */
+static void
+image_cache_unlink(image_surface_t *surface)
+{
+    if(surface->prev)
+        surface->prev->next = surface->next;
+    else
+        image_cache.first = surface->next;
+
+    if(surface->next)
+        surface->next->prev = surface->prev;
+    else
+        image_cache.last = surface->prev;
+
+    surface->prev = surface->next = NULL;
+}
+
+/** Put a copy first in the image cache, as the most recently drawn.
+ * \param surface The copy, not linked.
+ */
+static void
+image_cache_push(image_surface_t *surface)
+{
+    surface->next = image_cache.first;
+    if(image_cache.first)
+        image_cache.first->prev = surface;
+    else
+        image_cache.last = surface;
+    image_cache.first = surface;
+}
+
+/** Remove a copy from the image cache and its image.
+ * \param surface The copy.
+ */
+static void
+image_cache_remove(image_surface_t *surface)
+{
+    image_cache_unlink(surface);
+    surface->image->surfaces[surface->phys_screen] = NULL;
+    image_cache.size -= surface->size;
+    cairo_surface_destroy(surface->surface);
+    p_delete(&surface);
+}
+
+/** Remove the least recently drawn copies until the cache fits in its
+ * budget. */
+static void
+image_cache_evict(void)
+{
+    while(image_cache.size > image_cache.max && image_cache.last)
+        image_cache_remove(image_cache.last);
+}
+
+/** Mark an image as modified: its data need to be computed and sent to the
+ * server again.
+ * \param image The image.
+ */
+static void
+image_invalidate(image_t *image)
+{
+    image->isupdated = false;
+    image->shape_isupdated = false;
+    image->ismodified = true;
+
+    if(image->surfaces)
+    {
+        int nscreen = xcb_setup_roots_length(xcb_get_setup(globalconf.connection));
+
+        for(int i = 0; i < nscreen; i++)
+            if(image->surfaces[i])
+                image_cache_remove(image->surfaces[i]);
+    }
+}
+
+/** Get the memory budget of the server-side image cache.
+ * \return The budget in bytes.
+ */
+size_t
+image_cache_getsize(void)
+{
+    return image_cache.max;
+}
+
+/** Set the memory budget of the server-side image cache.
+ * \param max The budget in bytes, 0 to disable the cache.
+ */
+void
+image_cache_setsize(size_t max)
+{
+    image_cache.max = max;
+    image_cache_evict();
+}
+
 static int
 luaA_image_gc(lua_State *L)
 {
     image_t *p = luaA_checkudata(L, 1, &image_class);
+    image_invalidate(p);
+    p_delete(&p->surfaces);
     imlib_context_set_image(p->image);
     imlib_free_image();
     p_delete(&p->data);
+    p_delete(&p->shape);
     return luaA_object_gc(L);
 }
 
@@ -121,15 +269,8 @@ image_getheight(image_t *image)
 uint8_t *
 image_getdata(image_t *image)
 {
-    int size, i;
+    int size;
     uint32_t *data;
-    double alpha;
-    uint8_t *dataimg;
-#if AWESOME_IS_BIG_ENDIAN
-    const int index_a = 0, index_r = 1, index_g = 2, index_b = 3;
-#else
-    const int index_a = 3, index_r = 2, index_g = 1, index_b = 0;
-#endif
 
     if(image->isupdated)
         return image->data;
@@ -141,17 +282,9 @@ image_getdata(image_t *image)
     size = imlib_image_get_width() * imlib_image_get_height();
 
     p_realloc(&image->data, size * 4);
-    dataimg = image->data;
 
-    for(i = 0; i < size; i++, dataimg += 4)
-    {
-        dataimg[index_a] = (data[i] >> 24) & 0xff;           /* A */
-        /* cairo wants pre-multiplied alpha */
-        alpha = dataimg[index_a] / 255.0;
-        dataimg[index_r] = ((data[i] >> 16) & 0xff) * alpha; /* R */
-        dataimg[index_g] = ((data[i] >>  8) & 0xff) * alpha; /* G */
-        dataimg[index_b] = (data[i]         & 0xff) * alpha; /* B */
-    }
+    /* cairo wants pre-multiplied alpha */
+    pixel_premultiply((uint32_t *) image->data, data, size);
 
     image->isupdated = true;
 
@@ -159,6 +292,153 @@ image_getdata(image_t *image)
 
 }
 
+/** Get the rectangles covering the pixels of an image used as a shape.
+ * A pixel is in the shape if it is mostly white, alpha being ignored. Each
+ * line is scanned for runs of such pixels, and consecutive lines with the
+ * same runs are merged in a single band.
+ * \param image The image.
+ * \param len Filled with the number of rectangles.
+ * \return The rectangles, in YX banded order, owned by the image.
+ */
+xcb_rectangle_t *
+image_getshape(image_t *image, int *len)
+{
+    int width, height, size = 0, band = 0, band_len = 0;
+    uint32_t *data;
+
+    if(image->shape_isupdated)
+    {
+        *len = image->shape_len;
+        return image->shape;
+    }
+
+    imlib_context_set_image(image->image);
+    data = imlib_image_get_data_for_reading_only();
+    width = imlib_image_get_width();
+    height = imlib_image_get_height();
+
+    image->shape_len = 0;
+
+    for(int y = 0; y < height; y++)
+    {
+        const uint32_t *line = data + y * width;
+        int line_start = image->shape_len;
+
+        for(int x = 0; x < width;)
+        {
+            int start;
+
+            /* Sum up all color components ignoring alpha */
+#define PIXEL_ISSET(p) ((((p) >> 16) & 0xff) + (((p) >> 8) & 0xff) + ((p) & 0xff) > 380)
+            while(x < width && !PIXEL_ISSET(line[x]))
+                x++;
+            if(x == width)
+                break;
+            start = x;
+            while(x < width && PIXEL_ISSET(line[x]))
+                x++;
+#undef PIXEL_ISSET
+
+            if(image->shape_len >= size)
+            {
+                size = MAX(size * 2, 16);
+                p_realloc(&image->shape, size);
+            }
+
+            image->shape[image->shape_len++] = (xcb_rectangle_t)
+            {
+                .x = start, .y = y, .width = x - start, .height = 1
+            };
+        }
+
+        /* Same runs as the previous band: grow it instead */
+        if(band_len && band_len == image->shape_len - line_start)
+        {
+            bool same = true;
+
+            for(int i = 0; same && i < band_len; i++)
+                same = image->shape[band + i].x == image->shape[line_start + i].x
+                    && image->shape[band + i].width == image->shape[line_start + i].width;
+
+            if(same)
+            {
+                for(int i = 0; i < band_len; i++)
+                    image->shape[band + i].height++;
+                image->shape_len = line_start;
+                continue;
+            }
+        }
+
+        band = line_start;
+        band_len = image->shape_len - line_start;
+    }
+
+    image->shape_isupdated = true;
+
+    *len = image->shape_len;
+    return image->shape;
+}
+
+/** Get a server-side copy of an image, uploading it if needed.
+ * \param image The image.
+ * \param target The surface the image will be drawn to.
+ * \param phys_screen The physical screen of the target.
+ * \return A surface owned by the cache, or NULL if the image cannot be
+ * cached.
+ */
+cairo_surface_t *
+image_getsurface(image_t *image, cairo_surface_t *target, int phys_screen)
+{
+    int width = image_getwidth(image), height = image_getheight(image);
+    size_t size = width * height * 4;
+
+    if(image->surfaces && image->surfaces[phys_screen])
+    {
+        image_surface_t *surface = image->surfaces[phys_screen];
+        image_cache_unlink(surface);
+        image_cache_push(surface);
+        return surface->surface;
+    }
+
+    if(size > image_cache.max)
+        return NULL;
+
+    cairo_surface_t *copy = cairo_surface_create_similar(target, CAIRO_CONTENT_COLOR_ALPHA,
+                                                         width, height);
+    if(cairo_surface_status(copy) != CAIRO_STATUS_SUCCESS)
+    {
+        cairo_surface_destroy(copy);
+        return NULL;
+    }
+
+    cairo_surface_t *source =
+        cairo_image_surface_create_for_data(image_getdata(image), CAIRO_FORMAT_ARGB32,
+                                            width, height, width * 4);
+    cairo_t *cr = cairo_create(copy);
+    cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface(cr, source, 0, 0);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_destroy(source);
+
+    if(!image->surfaces)
+        image->surfaces = p_new(image_surface_t *,
+                                xcb_setup_roots_length(xcb_get_setup(globalconf.connection)));
+
+    image_surface_t *surface = p_new(image_surface_t, 1);
+    surface->image = image;
+    surface->phys_screen = phys_screen;
+    surface->surface = copy;
+    surface->size = size;
+
+    image->surfaces[phys_screen] = surface;
+    image_cache_push(surface);
+    image_cache.size += size;
+    image_cache_evict();
+
+    return copy;
+}
+
 static void
 image_draw_to_1bit_ximage(image_t *image, xcb_image_t *img)
 {
@@ -169,22 +449,29 @@ image_draw_to_1bit_ximage(image_t *image, xcb_image_t *img)
     int width = imlib_image_get_width();
     int height = imlib_image_get_height();
 
-    for(int y = 0; y < height; y++)
-        for(int x = 0; x < width; x++)
-        {
-            int i, pixel, tmp;
+    /* Whole bytes can be written directly if bits are in the same order in
+     * a byte and in a scanline unit */
+    if(img->bit_order == img->byte_order || img->unit == 8)
+        for(int y = 0; y < height; y++)
+            pixel_threshold(img->data + y * img->stride, data + y * width, width,
+                            img->bit_order == XCB_IMAGE_ORDER_MSB_FIRST);
+    else
+        for(int y = 0; y < height; y++)
+            for(int x = 0; x < width; x++)
+            {
+                int i, pixel, tmp;
 
-            i = y * width + x;
+                i = y * width + x;
 
-            // Sum up all color components ignoring alpha
-            tmp  = (data[i] >> 16) & 0xff;
-            tmp += (data[i] >>  8) & 0xff;
-            tmp +=  data[i]        & 0xff;
+                // Sum up all color components ignoring alpha
+                tmp  = (data[i] >> 16) & 0xff;
+                tmp += (data[i] >>  8) & 0xff;
+                tmp +=  data[i]        & 0xff;
 
-            pixel = (tmp / 3 < 127) ? 0 : 1;
+                pixel = (tmp / 3 < 127) ? 0 : 1;
 
-            xcb_image_put_pixel(img, x, y, pixel);
-        }
+                xcb_image_put_pixel(img, x, y, pixel);
+            }
 }
 
 // Convert an image to a 1bit pixmap
@@ -244,6 +531,75 @@ image_new_from_argb32(int width, int height, uint32_t *data)
     return 0;
 }
 
+/** Create a new image from ARGB32 data, scaled to another size.
+ * \param width The data width.
+ * \param height The data height.
+ * \param data The image data.
+ * \param new_width The image width.
+ * \param new_height The image height.
+ * \return 1 if an image has been pushed on stack, 0 otherwise.
+ */
+int
+image_new_from_argb32_scaled(int width, int height, uint32_t *data,
+                             int new_width, int new_height)
+{
+    Imlib_Image imimage, scaled;
+
+    if(width == new_width && height == new_height)
+        return image_new_from_argb32(width, height, data);
+
+    /* The data is only read while scaling, no need to copy it */
+    if(!(imimage = imlib_create_image_using_data(width, height, data)))
+        return 0;
+
+    imlib_context_set_image(imimage);
+    imlib_image_set_has_alpha(true);
+    scaled = imlib_create_cropped_scaled_image(0, 0, width, height,
+                                               new_width, new_height);
+    imlib_free_image();
+
+    if(scaled)
+    {
+        imlib_context_set_image(scaled);
+        imlib_image_set_has_alpha(true);
+        image_t *image = image_new(globalconf.L);
+        image->image = scaled;
+        return 1;
+    }
+
+    return 0;
+}
+
+/** Create a new image with the same content as another one.
+ * \param image The image to copy.
+ * \return 1 if an image has been pushed on stack, 0 otherwise.
+ */
+int
+image_new_copy(image_t *image)
+{
+    Imlib_Image imimage;
+
+    imlib_context_set_image(image->image);
+    if((imimage = imlib_clone_image()))
+    {
+        image_t *new = image_new(globalconf.L);
+        new->image = imimage;
+        return 1;
+    }
+
+    return 0;
+}
+
+/** Check if an image has been modified since its creation.
+ * \param image The image.
+ * \return True if the image has been drawn on or transformed in place.
+ */
+bool
+image_ismodified(image_t *image)
+{
+    return image->ismodified;
+}
+
 /** Create a new, completely black image.
  * \param width The image width.
  * \param height The image height.
@@ -364,7 +720,7 @@ luaA_image_orientate(lua_State *L)
     imlib_context_set_image(image->image);
     imlib_image_orientate(orientation);
 
-    image->isupdated = false;
+    image_invalidate(image);
 
     return 0;
 }
@@ -481,7 +837,7 @@ luaA_image_draw_pixel(lua_State *L)
 
     imlib_context_set_color(color.red, color.green, color.blue, color.alpha);
     imlib_image_draw_pixel(x, y, 1);
-    image->isupdated = false;
+    image_invalidate(image);
     return 0;
 }
 
@@ -514,7 +870,60 @@ luaA_image_draw_line(lua_State *L)
 
     imlib_context_set_color(color.red, color.green, color.blue, color.alpha);
     imlib_image_draw_line(x1, y1, x2, y2, 0);
-    image->isupdated = false;
+    image_invalidate(image);
+    return 0;
+}
+
+/** Scroll the content of an image, or of a part of it.
+ * The area uncovered keeps its previous content.
+ * \param L The Lua VM state
+ * \luastack
+ * \lvalue An image.
+ * \lparam The horizontal offset, positive to scroll right.
+ * \lparam The vertical offset, positive to scroll down.
+ * \lparam The x coordinate of the area to scroll (optional).
+ * \lparam The y coordinate of the area to scroll (optional).
+ * \lparam The width of the area to scroll (optional).
+ * \lparam The height of the area to scroll (optional).
+ */
+static int
+luaA_image_scroll(lua_State *L)
+{
+    image_t *image = luaA_checkudata(L, 1, &image_class);
+    int dx = luaL_checkint(L, 2);
+    int dy = luaL_checkint(L, 3);
+    int x, y, width, height, image_width, image_height;
+    uint32_t *data;
+
+    imlib_context_set_image(image->image);
+    image_width = imlib_image_get_width();
+    image_height = imlib_image_get_height();
+
+    x = MAX(luaL_optint(L, 4, 0), 0);
+    y = MAX(luaL_optint(L, 5, 0), 0);
+    width = MIN(luaL_optint(L, 6, image_width), image_width - x);
+    height = MIN(luaL_optint(L, 7, image_height), image_height - y);
+
+    if((!dx && !dy) || abs(dx) >= width || abs(dy) >= height)
+        return 0;
+
+    data = imlib_image_get_data() + y * image_width + x;
+
+    /* Go through the lines so that a line is moved before being overwritten */
+    if(dy > 0)
+        for(int line = height - 1; line >= dy; line--)
+            memmove(data + line * image_width + MAX(dx, 0),
+                    data + (line - dy) * image_width + MAX(-dx, 0),
+                    (width - abs(dx)) * sizeof(uint32_t));
+    else
+        for(int line = 0; line < height + dy; line++)
+            memmove(data + line * image_width + MAX(dx, 0),
+                    data + (line - dy) * image_width + MAX(-dx, 0),
+                    (width - abs(dx)) * sizeof(uint32_t));
+
+    imlib_image_put_back_data(data - y * image_width - x);
+    image_invalidate(image);
+
     return 0;
 }
 
@@ -552,7 +961,7 @@ luaA_image_draw_rectangle(lua_State *L)
         imlib_image_draw_rectangle(x, y, width, height);
     else
         imlib_image_fill_rectangle(x, y, width, height);
-    image->isupdated = false;
+    image_invalidate(image);
     return 0;
 }
 
@@ -638,7 +1047,7 @@ luaA_image_draw_rectangle_gradient(lua_State *L)
 
     imlib_free_color_range();
 
-    image->isupdated = false;
+    image_invalidate(image);
 
     return 0;
 }
@@ -677,7 +1086,7 @@ luaA_image_draw_circle(lua_State *L)
         imlib_image_draw_ellipse(x, y, ah, av);
     else
         imlib_image_fill_ellipse(x, y, ah, av);
-    image->isupdated = false;
+    image_invalidate(image);
     return 0;
 }
 
@@ -752,7 +1161,7 @@ luaA_image_insert(lua_State *L)
                                          * is the default */
                                         hxoff, hyoff, vxoff, vyoff);
 
-    image_target->isupdated = false;
+    image_invalidate(image_target);
 
     return 0;
 }
@@ -800,6 +1209,7 @@ image_class_setup(lua_State *L)
         { "crop_and_scale", luaA_image_crop_and_scale },
         { "save", luaA_image_save },
         { "insert", luaA_image_insert },
+        { "scroll", luaA_image_scroll },
         /* draw on images, whee! */
         { "draw_pixel", luaA_image_draw_pixel },
         { "draw_line",  luaA_image_draw_line  },
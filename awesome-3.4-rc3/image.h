@@ -23,17 +23,26 @@
 #define AWESOME_IMAGE_H
 
 #include <xcb/xcb.h>
+#include <cairo.h>
 #include "common/luaclass.h"
 
 typedef struct image image_t;
 
 void image_class_setup(lua_State *);
 int image_new_from_argb32(int, int, uint32_t *);
+int image_new_from_argb32_scaled(int, int, uint32_t *, int, int);
+int image_new_copy(image_t *);
+bool image_ismodified(image_t *);
 uint8_t * image_getdata(image_t *);
+cairo_surface_t * image_getsurface(image_t *, cairo_surface_t *, int);
 int image_getwidth(image_t *);
 int image_getheight(image_t *);
 
 xcb_pixmap_t image_to_1bit_pixmap(image_t *, xcb_drawable_t);
+xcb_rectangle_t * image_getshape(image_t *, int *);
+
+size_t image_cache_getsize(void);
+void image_cache_setsize(size_t);
 
 lua_class_t image_class;
 
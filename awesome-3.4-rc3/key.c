@@ -959,6 +959,7 @@ luaA_keystore(lua_State *L, int ud, const char *str, ssize_t len)
             key->keycode = atoi(str + 1);
             key->keysym = 0;
         }
+        key_index_invalidate();
         luaA_object_emit_signal(L, ud, "property::key", 0);
     }
 }
@@ -1015,6 +1016,311 @@ luaA_key_new(lua_State *L)
     return luaA_class_new(L, &key_class);
 }
 
+/** Generation of the keys, bumped each time a key or the keyboard mapping changes */
+static unsigned int key_generation = 1;
+
+/** Mark all key array indexes as outdated.
+ */
+void
+key_index_invalidate(void)
+{
+    key_generation++;
+}
+
+static int
+key_index_entry_cmp(const void *a, const void *b)
+{
+    const key_index_entry_t *x = a, *y = b;
+
+    if(x->keysym != y->keysym)
+        return x->keysym < y->keysym ? -1 : 1;
+    if(x->keycode != y->keycode)
+        return x->keycode < y->keycode ? -1 : 1;
+    if(x->ignore_locks != y->ignore_locks)
+        return x->ignore_locks < y->ignore_locks ? -1 : 1;
+    if(x->modifiers != y->modifiers)
+        return x->modifiers < y->modifiers ? -1 : 1;
+    return x->position - y->position;
+}
+
+/** Get the modifiers standing for Caps Lock, Shift Lock and Num Lock.
+ * \return The lock modifiers mask.
+ */
+static uint16_t
+key_lock_mask(void)
+{
+    return XCB_MOD_MASK_LOCK | globalconf.numlockmask
+        | globalconf.shiftlockmask | globalconf.capslockmask;
+}
+
+/** Rebuild a key array index if any key changed since it was built.
+ * \param index The index.
+ * \param keys The key array it indexes.
+ */
+static void
+key_index_update(key_index_t *index, key_array_t *keys)
+{
+    if(index->generation == key_generation)
+        return;
+
+    uint16_t locks = key_lock_mask();
+
+    index->entries.len = 0;
+
+    for(int i = 0; i < keys->len; i++)
+    {
+        keyb_t *k = keys->tab[i];
+        key_index_entry_t e = { .modifiers = k->modifiers, .position = i };
+
+        if(k->ignore_locks && k->modifiers != XCB_BUTTON_MASK_ANY)
+        {
+            e.ignore_locks = true;
+            e.modifiers &= ~locks;
+        }
+
+        if(k->keycode)
+        {
+            e.keycode = k->keycode;
+            key_index_entry_array_append(&index->entries, e);
+            e.keycode = 0;
+        }
+        if(k->keysym)
+        {
+            e.keysym = k->keysym;
+            key_index_entry_array_append(&index->entries, e);
+        }
+    }
+
+    qsort(index->entries.tab, index->entries.len, sizeof(key_index_entry_t), key_index_entry_cmp);
+    index->generation = key_generation;
+}
+
+/** Add the positions of the index entries equal to an entry to a list.
+ * \param index The index.
+ * \param e The entry to look for, its position being ignored.
+ * \param positions The list of positions.
+ * \param n The number of positions in the list, updated.
+ */
+static void
+key_index_find(key_index_t *index, key_index_entry_t e, int *positions, int *n)
+{
+    int l = 0, r = index->entries.len;
+
+    /* Find the first entry not lower than e */
+    e.position = -1;
+    while(l < r)
+    {
+        int i = (l + r) / 2;
+        if(key_index_entry_cmp(&index->entries.tab[i], &e) < 0)
+            l = i + 1;
+        else
+            r = i;
+    }
+
+    for(; l < index->entries.len; l++)
+    {
+        key_index_entry_t *entry = &index->entries.tab[l];
+        if(entry->keysym != e.keysym
+           || entry->keycode != e.keycode
+           || entry->ignore_locks != e.ignore_locks
+           || entry->modifiers != e.modifiers)
+            break;
+        positions[(*n)++] = entry->position;
+    }
+}
+
+/** Find the keys of an array matching a key event.
+ * \param index The index of the array.
+ * \param keys The key array.
+ * \param keycode The keycode of the event.
+ * \param keysym The keysym of the event, without modifiers.
+ * \param state The modifiers state of the event.
+ * \param positions Filled with the positions of the matching keys in the
+ * array, in order. It must have room for twice the array length.
+ * \return The number of matching keys.
+ */
+int
+key_index_lookup(key_index_t *index, key_array_t *keys,
+                 xcb_keycode_t keycode, xcb_keysym_t keysym, uint16_t state,
+                 int *positions)
+{
+    int n = 0, matching = 0;
+    key_index_entry_t wanted[] =
+    {
+        { .modifiers = state },
+        { .modifiers = XCB_BUTTON_MASK_ANY },
+        { .ignore_locks = true, .modifiers = state & ~key_lock_mask() },
+    };
+
+    key_index_update(index, keys);
+
+    for(int i = 0; i < countof(wanted); i++)
+    {
+        if(i == 1 && state == XCB_BUTTON_MASK_ANY)
+            continue;
+
+        if(keycode)
+        {
+            wanted[i].keycode = keycode;
+            key_index_find(index, wanted[i], positions, &n);
+            wanted[i].keycode = 0;
+        }
+        if(keysym)
+        {
+            wanted[i].keysym = keysym;
+            key_index_find(index, wanted[i], positions, &n);
+        }
+    }
+
+    /* Keep the array order */
+    for(int i = 1; i < n; i++)
+    {
+        int p = positions[i], j = i;
+        for(; j > 0 && positions[j - 1] > p; j--)
+            positions[j] = positions[j - 1];
+        positions[j] = p;
+    }
+
+    /* A key matching by keycode and keysym is only run once */
+    for(int i = 0; i < n; i++)
+        if(!matching || positions[matching - 1] != positions[i])
+            positions[matching++] = positions[i];
+
+    return matching;
+}
+
+/** The keycodes of a keysym */
+typedef struct
+{
+    xcb_keysym_t keysym;
+    /** Zero terminated, or NULL if the keysym is not mapped */
+    xcb_keycode_t *keycodes;
+} keysym_keycodes_t;
+
+static int
+keysym_keycodes_cmp(const void *a, const void *b)
+{
+    const keysym_keycodes_t *x = a, *y = b;
+    return x->keysym > y->keysym ? 1 : (x->keysym < y->keysym ? -1 : 0);
+}
+
+static void
+keysym_keycodes_wipe(keysym_keycodes_t *k)
+{
+    p_delete(&k->keycodes);
+}
+
+DO_BARRAY(keysym_keycodes_t, keysym_keycodes, keysym_keycodes_wipe, keysym_keycodes_cmp)
+
+/** Keycodes of the keysyms already looked up in the keyboard mapping */
+static keysym_keycodes_array_t keysym_keycodes;
+
+/** The last key array grabs were computed for, and these grabs */
+static struct
+{
+    keyb_t **keys;
+    int len;
+    unsigned int generation;
+    key_grab_array_t grabs;
+} key_grabs_last;
+
+/** Forget the keycodes of all keysyms, because the keyboard mapping changed.
+ */
+void
+key_keycodes_invalidate(void)
+{
+    keysym_keycodes_array_wipe(&keysym_keycodes);
+    keysym_keycodes_array_init(&keysym_keycodes);
+    key_index_invalidate();
+}
+
+/** Get the keycodes of a keysym, scanning the keyboard mapping only the
+ * first time.
+ * \param keysym The keysym.
+ * \return The zero terminated keycodes, or NULL.
+ */
+static const xcb_keycode_t *
+key_keycodes(xcb_keysym_t keysym)
+{
+    keysym_keycodes_t k = { .keysym = keysym }, *found;
+
+    if((found = keysym_keycodes_array_lookup(&keysym_keycodes, &k)))
+        return found->keycodes;
+
+    k.keycodes = xcb_key_symbols_get_keycode(globalconf.keysyms, keysym);
+    keysym_keycodes_array_insert(&keysym_keycodes, k);
+    return k.keycodes;
+}
+
+/** Add the key combinations to grab for a key on one keycode.
+ * \param grabs The combinations.
+ * \param k The key.
+ * \param keycode The keycode.
+ */
+static void
+key_grabs_insert(key_grab_array_t *grabs, keyb_t *k, xcb_keycode_t keycode)
+{
+    if(!k->ignore_locks || k->modifiers == XCB_BUTTON_MASK_ANY)
+    {
+        key_grab_array_insert(grabs, (key_grab_t) { .keycode = keycode,
+                                                    .modifiers = k->modifiers });
+        return;
+    }
+
+    /* One grab per combination of the locks, as X has no way to ignore them */
+    uint16_t locks = key_lock_mask();
+    uint16_t modifiers = k->modifiers & ~locks;
+
+    for(uint16_t set = locks;; set = (set - 1) & locks)
+    {
+        key_grab_array_insert(grabs, (key_grab_t) { .keycode = keycode,
+                                                    .modifiers = modifiers | set });
+        if(!set)
+            break;
+    }
+}
+
+/** Compute the key combinations to grab for a key array.
+ * \param keys The key array.
+ * \param grabs Filled with the combinations, sorted.
+ */
+void
+key_array_grabs(key_array_t *keys, key_grab_array_t *grabs)
+{
+    grabs->len = 0;
+
+    /* Clients usually all get the same keys: reuse the last result */
+    if(key_grabs_last.generation == key_generation
+       && key_grabs_last.len == keys->len
+       && !memcmp(key_grabs_last.keys, keys->tab, keys->len * sizeof(keyb_t *)))
+    {
+        key_grab_array_splice(grabs, 0, 0, key_grabs_last.grabs.tab, key_grabs_last.grabs.len);
+        return;
+    }
+
+    foreach(_k, *keys)
+    {
+        keyb_t *k = *_k;
+
+        if(k->keycode)
+            key_grabs_insert(grabs, k, k->keycode);
+        else if(k->keysym)
+        {
+            const xcb_keycode_t *keycodes = key_keycodes(k->keysym);
+            if(keycodes)
+                for(const xcb_keycode_t *kc = keycodes; *kc; kc++)
+                    key_grabs_insert(grabs, k, *kc);
+        }
+    }
+
+    p_realloc(&key_grabs_last.keys, keys->len);
+    memcpy(key_grabs_last.keys, keys->tab, keys->len * sizeof(keyb_t *));
+    key_grabs_last.len = keys->len;
+    key_grabs_last.generation = key_generation;
+    key_grabs_last.grabs.len = 0;
+    key_grab_array_splice(&key_grabs_last.grabs, 0, 0, grabs->tab, grabs->len);
+}
+
 /** Set a key array with a Lua table.
  * \param L The Lua VM state.
  * \param oidx The index of the object to store items into.
@@ -1108,11 +1414,26 @@ static int
 luaA_key_set_modifiers(lua_State *L, keyb_t *k)
 {
     k->modifiers = luaA_tomodifiers(L, -1);
+    key_index_invalidate();
     luaA_object_emit_signal(L, -3, "property::modifiers", 0);
     return 0;
 }
 
 LUA_OBJECT_EXPORT_PROPERTY(key, keyb_t, modifiers, luaA_pushmodifiers)
+LUA_OBJECT_EXPORT_PROPERTY(key, keyb_t, ignore_locks, lua_pushboolean)
+
+static int
+luaA_key_set_ignore_locks(lua_State *L, keyb_t *k)
+{
+    bool b = luaA_checkboolean(L, -1);
+    if(b != k->ignore_locks)
+    {
+        k->ignore_locks = b;
+        key_index_invalidate();
+        luaA_object_emit_signal(L, -3, "property::ignore_locks", 0);
+    }
+    return 0;
+}
 
 static int
 luaA_key_get_key(lua_State *L, keyb_t *k)
@@ -1183,6 +1504,10 @@ key_class_setup(lua_State *L)
                             (lua_class_propfunc_t) luaA_key_set_modifiers,
                             (lua_class_propfunc_t) luaA_key_get_modifiers,
                             (lua_class_propfunc_t) luaA_key_set_modifiers);
+    luaA_class_add_property(&key_class, A_TK_IGNORE_LOCKS,
+                            (lua_class_propfunc_t) luaA_key_set_ignore_locks,
+                            (lua_class_propfunc_t) luaA_key_get_ignore_locks,
+                            (lua_class_propfunc_t) luaA_key_set_ignore_locks);
 }
 
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
@@ -33,17 +33,88 @@ typedef struct keyb_t
     xcb_keysym_t keysym;
     /** Keycode */
     xcb_keycode_t keycode;
+    /** Match and grab whatever the state of Caps Lock and Num Lock */
+    bool ignore_locks;
 } keyb_t;
 
 lua_class_t key_class;
 LUA_OBJECT_FUNCS(key_class, keyb_t, key)
 DO_ARRAY(keyb_t *, key, DO_NOTHING)
 
+/** An entry of a key array index */
+typedef struct
+{
+    /** Keysym of the key, 0 for an entry by keycode */
+    xcb_keysym_t keysym;
+    /** Keycode of the key, 0 for an entry by keysym */
+    xcb_keycode_t keycode;
+    /** True if the lock modifiers are removed from modifiers */
+    bool ignore_locks;
+    /** Key modifier */
+    uint16_t modifiers;
+    /** Position of the key in its array */
+    int position;
+} key_index_entry_t;
+DO_ARRAY(key_index_entry_t, key_index_entry, DO_NOTHING)
+
+/** Index of a key array by keycode or keysym and modifiers, used to find
+ * the keys matching an event. It is rebuilt on first use after any key or
+ * key array changed. */
+typedef struct
+{
+    /** Entries, sorted */
+    key_index_entry_array_t entries;
+    /** Keys generation it was built for */
+    unsigned int generation;
+} key_index_t;
+
+/** Mark a key array index as outdated, after its array was set.
+ * \param index The index.
+ */
+static inline void
+key_index_reset(key_index_t *index)
+{
+    index->generation = 0;
+}
+
+/** Wipe a key array index.
+ * \param index The index.
+ */
+static inline void
+key_index_wipe(key_index_t *index)
+{
+    key_index_entry_array_wipe(&index->entries);
+    p_clear(index, 1);
+}
+
+/** A key combination grabbed on a window */
+typedef struct
+{
+    xcb_keycode_t keycode;
+    uint16_t modifiers;
+} key_grab_t;
+
+static inline int
+key_grab_cmp(const void *a, const void *b)
+{
+    const key_grab_t *x = a, *y = b;
+    if(x->keycode != y->keycode)
+        return x->keycode > y->keycode ? 1 : -1;
+    return x->modifiers > y->modifiers ? 1 : (x->modifiers < y->modifiers ? -1 : 0);
+}
+
+DO_BARRAY(key_grab_t, key_grab, DO_NOTHING, key_grab_cmp)
+
 void key_class_setup(lua_State *);
 
 bool key_press_lookup_string(xcb_keysym_t, char *, ssize_t);
 xcb_keysym_t key_getkeysym(xcb_keycode_t, uint16_t);
 
+void key_index_invalidate(void);
+void key_keycodes_invalidate(void);
+void key_array_grabs(key_array_t *, key_grab_array_t *);
+int key_index_lookup(key_index_t *, key_array_t *, xcb_keycode_t, xcb_keysym_t, uint16_t, int *);
+
 void luaA_key_array_set(lua_State *, int, int, key_array_t *);
 int luaA_key_array_get(lua_State *, int, key_array_t *);
 
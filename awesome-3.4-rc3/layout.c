@@ -0,0 +1,293 @@
+/*
+ * layout.c - tiling layouts
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* These compute the geometries the layouts of awful.layout.suit ask for.
+ * Nothing is applied here: the caller commits all of them at once with
+ * client_resize_batch(). */
+
+#include <math.h>
+
+#include "layout.h"
+#include "client.h"
+
+/** Swap the axes of an area, so top and bottom tiling can be computed as
+ * left and right tiling.
+ * \param a The area.
+ * \param swap Whether to swap.
+ * \return The area, swapped if asked.
+ */
+static inline area_t
+layout_swap(area_t a, bool swap)
+{
+    if(swap)
+        return (area_t) { .x = a.y, .y = a.x, .width = a.height, .height = a.width };
+    return a;
+}
+
+/** Get the smallest size of a client along the axis its column grows on.
+ * \param c The client.
+ * \param swap Whether the axes are swapped.
+ * \return The minimum or base size, with borders.
+ */
+static int
+layout_tile_size_hint(client_t *c, bool swap)
+{
+    int hint = 0;
+
+    if(c->size_hints.flags & XCB_SIZE_HINT_P_MIN_SIZE)
+        hint = swap ? c->size_hints.min_height : c->size_hints.min_width;
+    else if(c->size_hints.flags & XCB_SIZE_HINT_BASE_SIZE)
+        hint = swap ? c->size_hints.base_height : c->size_hints.base_width;
+
+    return hint + c->border_width * 2;
+}
+
+/** Tile a group of clients in a column.
+ * \param cls The clients.
+ * \param wa The work area, with axes swapped if needed.
+ * \param swap Whether the axes are swapped.
+ * \param fact The height factors of the group, negative ones get a default.
+ * \param first The first client of the group.
+ * \param last The last client of the group.
+ * \param coord The column position.
+ * \param size The column width.
+ * \param geometries Where to store the geometries.
+ * \return The width used by the column.
+ */
+static double
+layout_tile_group(client_t **cls, area_t wa, bool swap, double *fact,
+                  int first, int last, double coord, double size,
+                  area_t *geometries)
+{
+    double available = wa.width - (coord - wa.x);
+    double total_fact = 0, min_fact = 1, used_size = 0;
+    double y = wa.y, unused = wa.height;
+
+    for(int c = first; c <= last; c++)
+    {
+        int i = c - first;
+        int size_hint = layout_tile_size_hint(cls[c], swap);
+
+        size = MAX(size_hint, size);
+
+        if(fact[i] < 0)
+            fact[i] = min_fact;
+        else
+            min_fact = MIN(fact[i], min_fact);
+        total_fact += fact[i];
+    }
+    size = MIN(size, available);
+
+    for(int c = first; c <= last; c++)
+    {
+        int i = c - first;
+        area_t geometry;
+
+        geometry.x = coord;
+        geometry.y = y;
+        geometry.width = size;
+        geometry.height = floor(unused * fact[i] / total_fact);
+
+        /* The next client goes after what this one really gets */
+        geometries[c] = client_geometry_fit(cls[c], layout_swap(geometry, swap));
+        geometry = layout_swap(geometries[c], swap);
+
+        y += geometry.height;
+        unused -= geometry.height;
+        total_fact -= fact[i];
+        used_size = MAX(used_size, geometry.width);
+    }
+
+    return used_size;
+}
+
+/** Tile clients: masters in one column, others in ncol columns.
+ * \param cls The clients.
+ * \param n The number of clients.
+ * \param wa The work area.
+ * \param position The side of the other columns.
+ * \param mwfact The part of the work area for the masters.
+ * \param nmaster The number of masters.
+ * \param ncol The number of columns of the other clients.
+ * \param facts The height factors of each column, the masters first, with
+ * room for n values each. Negative ones are replaced by the default.
+ * \param geometries Where to store the geometries.
+ */
+void
+layout_tile(client_t **cls, int n, area_t wa, position_t position,
+            double mwfact, int nmaster, int ncol, double **facts,
+            area_t *geometries)
+{
+    bool swap = position == Top || position == Bottom;
+    /* On the left or top the other windows are placed first */
+    bool place_master = !(position == Left || position == Top);
+    double coord;
+
+    nmaster = MIN(nmaster, n);
+    int nother = MAX(n - nmaster, 0);
+
+    wa = layout_swap(wa, swap);
+    coord = wa.x;
+
+    for(int d = 0; d < 2; d++)
+    {
+        if(place_master && nmaster > 0)
+        {
+            double size = wa.width;
+            if(nother > 0)
+                size = MIN(wa.width * mwfact, wa.width - (coord - wa.x));
+            coord += layout_tile_group(cls, wa, swap, facts[0],
+                                       0, nmaster - 1, coord, size, geometries);
+        }
+
+        if(!place_master && nother > 0)
+        {
+            int last = nmaster;
+            double wasize = wa.width;
+
+            /* Consider the masters space on the left and top */
+            if(nmaster > 0 && (position == Left || position == Top))
+                wasize = wa.width - wa.width * mwfact;
+
+            for(int i = 1; i <= ncol; i++)
+            {
+                /* Try to get equal width among remaining columns */
+                double size = (wasize - (coord - wa.x)) / (ncol - i + 1);
+                int first = last;
+                last += (n - last) / (ncol - i + 1);
+                coord += layout_tile_group(cls, wa, swap, facts[i],
+                                           first, last - 1, coord, size, geometries);
+            }
+        }
+
+        place_master = !place_master;
+    }
+}
+
+/** Place clients in a grid of equal cells.
+ * \param cls The clients.
+ * \param n The number of clients.
+ * \param wa The work area.
+ * \param orientation East for rows of cells, South for columns.
+ * \param geometries Where to store the geometries.
+ */
+void
+layout_fair(client_t **cls, int n, area_t wa, orientation_t orientation,
+            area_t *geometries)
+{
+    int cells = 0, strips, cell = 0, strip = 0;
+
+    if(n <= 0)
+        return;
+
+    while(cells * cells < n)
+        cells++;
+    strips = (n + cells - 1) / cells;
+
+    for(int k = 0; k < n; k++)
+    {
+        /* The last strip shares its length between the remaining clients */
+        int nstrip = (n < strips * cells && strip == strips - 1) ?
+            cells - (strips * cells - n) : cells;
+        double width, height;
+
+        if((orientation == East && n > 2) || (orientation != East && n <= 2))
+        {
+            width = (double) wa.width / nstrip;
+            height = (double) wa.height / strips;
+            geometries[k].x = wa.x + cell * width;
+            geometries[k].y = wa.y + strip * height;
+        }
+        else
+        {
+            height = (double) wa.height / nstrip;
+            width = (double) wa.width / strips;
+            geometries[k].x = wa.x + strip * width;
+            geometries[k].y = wa.y + cell * height;
+        }
+        geometries[k].width = width;
+        geometries[k].height = height;
+
+        if(++cell == cells)
+        {
+            cell = 0;
+            strip++;
+        }
+    }
+}
+
+/** Give every client the whole area.
+ * \param cls The clients.
+ * \param n The number of clients.
+ * \param area The work area, or the screen geometry for fullscreen.
+ * \param geometries Where to store the geometries.
+ */
+void
+layout_max(client_t **cls, int n, area_t area, area_t *geometries)
+{
+    for(int k = 0; k < n; k++)
+        geometries[k] = area;
+}
+
+/** Center the focused client and stack the others on the side.
+ * \param cls The clients.
+ * \param n The number of clients.
+ * \param focus The index of the focused client.
+ * \param wa The work area.
+ * \param mwfact The part of the work area for the focused client.
+ * \param geometries Where to store the geometries.
+ */
+void
+layout_magnifier(client_t **cls, int n, int focus, area_t wa, double mwfact,
+                 area_t *geometries)
+{
+    double height, y;
+
+    if(focus < 0 || focus >= n)
+        return;
+
+    if(n == 1)
+    {
+        geometries[focus] = wa;
+        return;
+    }
+
+    geometries[focus].width = wa.width * sqrt(mwfact);
+    geometries[focus].height = wa.height * sqrt(mwfact);
+    geometries[focus].x = wa.x + (wa.width - wa.width * sqrt(mwfact)) / 2;
+    geometries[focus].y = wa.y + (wa.height - wa.height * sqrt(mwfact)) / 2;
+
+    height = (double) wa.height / (n - 1);
+    y = wa.y;
+
+    /* Clients after the focused one come first, so the next focused client
+     * is the one at the top of the screen */
+    for(int i = 1; i < n; i++, y += height)
+    {
+        int k = (focus + i) % n;
+        geometries[k].x = wa.x;
+        geometries[k].y = y;
+        geometries[k].width = wa.width;
+        geometries[k].height = height;
+    }
+}
+
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
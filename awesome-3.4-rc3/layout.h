@@ -0,0 +1,33 @@
+/*
+ * layout.h - tiling layouts header
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AWESOME_LAYOUT_H
+#define AWESOME_LAYOUT_H
+
+#include "globalconf.h"
+
+void layout_tile(client_t **, int, area_t, position_t, double, int, int, double **, area_t *);
+void layout_fair(client_t **, int, area_t, orientation_t, area_t *);
+void layout_max(client_t **, int, area_t, area_t *);
+void layout_magnifier(client_t **, int, int, area_t, double, area_t *);
+
+#endif
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
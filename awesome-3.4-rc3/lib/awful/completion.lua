@@ -12,6 +12,10 @@ local table = table
 local math = math
 local print = print
 local util = require("awful.util")
+local capi =
+{
+    awesome = awesome
+}
 
 --- Completion module.
 -- This module store a set of function using shell to complete commands name.
@@ -23,21 +27,19 @@ local bashcomp_src = "/usr/local/etc/bash_completion"
 
 --- Enable programmable bash completion in awful.completion.bash at the price of
 -- a slight overhead.
+-- The completion functions are loaded in the background.
 -- @param src The bash completion source file, /etc/bash_completion by default.
 function bashcomp_load(src)
     if src then bashcomp_src = src end
-    local c, err = io.popen("/usr/bin/env bash -c 'source " .. bashcomp_src .. "; complete -p'")
-    if c then
-        while true do
-            local line = c:read("*line")
-            if not line then break end
-            -- if a bash function is used for completion, register it
-            if line:match(".* -F .*") then
-                bashcomp_funcs[line:gsub(".* (%S+)$","%1")] = line:gsub(".*-F +(%S+) .*$", "%1")
-            end
-        end
-        c:close()
-    else
+    local pid, err = capi.awesome.spawn_async("/usr/bin/env bash -c 'source " .. bashcomp_src .. "; complete -p'",
+        { lines = true,
+          stdout = function (line)
+              -- if a bash function is used for completion, register it
+              if line:match(".* -F .*") then
+                  bashcomp_funcs[line:gsub(".* (%S+)$","%1")] = line:gsub(".*-F +(%S+) .*$", "%1")
+              end
+          end })
+    if not pid then
         print(err)
     end
 end
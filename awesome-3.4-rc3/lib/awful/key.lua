@@ -13,22 +13,29 @@ local util = require("awful.util")
 --- Create easily new key objects ignoring certain modifiers.
 module("awful.key")
 
---- Modifiers to ignore.
--- By default this is initialized as { "Lock", "Mod2" }
--- so the Caps Lock or Num Lock modifier are not taking into account by awesome
--- when pressing keys.
+--- Ignore Caps Lock, Shift Lock and Num Lock.
+-- If true, which is the default, awesome ignores these locks itself, whatever
+-- modifier they are on, so only one key object is created for them.
+-- @name ignore_locks
+-- @class boolean
+ignore_locks = true
+
+--- Other modifiers to ignore.
+-- By default this is empty, as the locks are handled by ignore_locks. Do not
+-- put the lock modifiers here if ignore_locks is true, or the key would be
+-- triggered once per combination.
 -- @name ignore_modifiers
 -- @class table
-ignore_modifiers = { "Lock", "Mod2" }
+ignore_modifiers = { }
 
 --- Create a new key to use as binding.
 -- This function is useful to create several keys from one, because it will use
 -- the ignore_modifier variable to create more key with or without the ignored
 -- modifiers activated.
--- For example if you want to ignore CapsLock in your keybinding (which is
--- ignored by default by this function), creating key binding with this function
--- will return 2 key objects: one with CapsLock on, and the other one with
--- CapsLock off.
+-- For example if you want to ignore Mod5 in your keybinding, creating key
+-- binding with this function will return 2 key objects: one with Mod5 on, and
+-- the other one with Mod5 off. Locks are ignored by awesome itself, see
+-- ignore_locks.
 -- @see capi.key
 -- @return A table with one or several key objects.
 function new(mod, key, press, release)
@@ -36,7 +43,8 @@ function new(mod, key, press, release)
     local subsets = util.subsets(ignore_modifiers)
     for _, set in ipairs(subsets) do
         ret[#ret + 1] = capi.key({ modifiers = util.table.join(mod, set),
-                                   key = key })
+                                   key = key,
+                                   ignore_locks = ignore_locks })
         if press then
             ret[#ret]:add_signal("press", function(kobj, ...) press(...) end)
         end
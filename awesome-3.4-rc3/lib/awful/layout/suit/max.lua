@@ -5,31 +5,16 @@
 ---------------------------------------------------------------------------
 
 -- Grab environment we need
-local pairs = pairs
-local client = require("awful.client")
+local capi = { screen = screen }
 
 --- Maximized and fullscreen layouts module for awful
 module("awful.layout.suit.max")
 
-local function fmax(p, fs)
-    -- Fullscreen?
-    local area
-    if fs then
-        area = p.geometry
-    else
-        area = p.workarea
-    end
-
-    for k, c in pairs(p.clients) do
-        c:geometry(area)
-    end
-end
-
 --- Maximized layout.
 -- @param screen The screen to arrange.
 name = "max"
 function arrange(p)
-    return fmax(p, false)
+    return capi.screen[p.screen]:arrange_layout("max", p)
 end
 
 --- Fullscreen layout.
@@ -37,5 +22,5 @@ end
 fullscreen = {}
 fullscreen.name = "fullscreen"
 function fullscreen.arrange(p)
-    return fmax(p, true)
+    return capi.screen[p.screen]:arrange_layout("fullscreen", p)
 end
@@ -7,6 +7,7 @@
 
 -- Grab environment we need
 local ipairs = ipairs
+local capi = { screen = screen }
 
 module("awful.layout.suit.spiral")
 
@@ -14,6 +15,7 @@ local function spiral(p, spiral)
     local wa = p.workarea
     local cls = p.clients
     local n = #cls
+    local geometries = {}
 
     for k, c in ipairs(cls) do
         if k < n then
@@ -38,8 +40,10 @@ local function spiral(p, spiral)
             wa.y = wa.y + wa.height
         end
 
-        c:geometry(wa)
+        geometries[c] = { x = wa.x, y = wa.y, width = wa.width, height = wa.height }
     end
+
+    capi.screen[p.screen]:arrange_batch(geometries)
 end
 
 --- Dwindle layout
@@ -7,157 +7,39 @@
 ---------------------------------------------------------------------------
 
 -- Grab environment we need
-local ipairs = ipairs
-local math = math
 local tag = require("awful.tag")
+local capi = { screen = screen }
 
 --- Tiled layouts module for awful
 module("awful.layout.suit.tile")
 
-local function tile_group(cls, wa, orientation, fact, group)
-    -- get our orientation right
-    local height = "height"
-    local width = "width"
-    local x = "x"
-    local y = "y"
-    if orientation == "top" or orientation == "bottom" then
-        height = "width"
-        width = "height"
-        x = "y"
-        y = "x"
-    end
-
-    -- make this more generic (not just width)
-    available = wa[width] - (group.coord - wa[x])
-
-    -- find our total values
-    local total_fact = 0
-    local min_fact = 1
-    local size = group.size
-    for c = group.first,group.last do
-        -- determine the width/height based on the size_hint
-        local i = c - group.first +1
-        local size_hints = cls[c].size_hints
-        local size_hint = size_hints["min_"..width] or size_hints["base_"..width] or 0
-        size_hint = size_hint + cls[c].border_width*2
-        size = math.max(size_hint, size)
-
-        -- calculate the height
-        if not fact[i] then
-            fact[i] = min_fact
-        else
-            min_fact = math.min(fact[i],min_fact)
-        end
-        total_fact = total_fact + fact[i]
-    end
-    size = math.min(size, available)
-
-    local coord = wa[y]
-    local geom = {}
-    local used_size = 0
-    local unused = wa[height]
-    for c = group.first,group.last do
-        local i = c - group.first +1
-        geom[width] = size
-        geom[height] = math.floor(unused * fact[i] / total_fact)
-        geom[x] = group.coord
-        geom[y] = coord
-        geom = cls[c]:geometry(geom)
-        coord = coord + geom[height]
-        unused = unused - geom[height]
-        total_fact = total_fact - fact[i]
-        used_size = math.max(used_size, geom[width])
-    end
-
-    return used_size
-end
-
-local function tile(param, orientation)
-    local t = tag.selected(param.screen)
-    orientation = orientation or "right"
-
-    -- this handles are different orientations
-    local height = "height"
-    local width = "width"
-    local x = "x"
-    local y = "y"
-    if orientation == "top" or orientation == "bottom" then
-        height = "width"
-        width = "height"
-        x = "y"
-        y = "x"
-    end
-
-    local cls = param.clients
-    local nmaster = math.min(tag.getnmaster(t), #cls)
-    local nother = math.max(#cls - nmaster,0)
-
-    local mwfact = tag.getmwfact(t)
-    local wa = param.workarea
-    local ncol = tag.getncol(t)
-
-    local data = tag.getdata(t).windowfact
-
-    if not data then
-        data = {}
-        tag.getdata(t).windowfact = data
-    end
+local function tile(p, name)
+    local t = tag.selected(p.screen)
+    local data = tag.getdata(t)
 
-    local coord = wa[x]
-    local place_master = true
-    if orientation == "left" or orientation == "top" then
-        -- if we are on the left or top we need to render the other windows first
-        place_master = false
-    end
-
-    -- this was easier than writing functions because there is a lot of data we need
-    for d = 1,2 do
-        if place_master and nmaster > 0 then
-            local size = wa[width]
-            if nother > 0 then
-                size = math.min(wa[width] * mwfact, wa[width] - (coord - wa[x]))
-            end
-            if not data[0] then
-                data[0] = {}
-            end
-            coord = coord + tile_group(cls, wa, orientation, data[0], {first=1, last=nmaster, coord = coord, size = size})
-        end
-
-        if not place_master and nother > 0 then
-            local last = nmaster
-
-            -- we have to modify the work area size to consider left and top views
-            local wasize = wa[width]
-            if nmaster > 0 and (orientation == "left" or orientation == "top") then
-                wasize = wa[width] - wa[width]*mwfact
-            end
-            for i = 1,ncol do
-                -- Try to get equal width among remaining columns
-                local size = math.min( (wasize - (coord - wa[x])) / (ncol - i + 1) )
-                local first = last + 1
-                last = last + math.floor((#cls - last)/(ncol - i + 1))
-                -- tile the column and update our current x coordinate
-                if not data[i] then
-                    data[i] = {}
-                end
-                coord = coord + tile_group(cls, wa, orientation, data[i], { first = first, last = last, coord = coord, size = size })
-            end
-        end
-        place_master = not place_master
+    if not data.windowfact then
+        data.windowfact = {}
     end
 
+    p.mwfact = tag.getmwfact(t)
+    p.nmaster = tag.getnmaster(t)
+    p.ncol = tag.getncol(t)
+    p.windowfact = data.windowfact
+    capi.screen[p.screen]:arrange_layout(name, p)
 end
 
 right = {}
 right.name = "tile"
-right.arrange = tile
+function right.arrange(p)
+    return tile(p, "tile")
+end
 
 --- The main tile algo, on left.
 -- @param screen The screen number to tile.
 left = {}
 left.name = "tileleft"
 function left.arrange(p)
-    return tile(p, "left")
+    return tile(p, "tileleft")
 end
 
 --- The main tile algo, on bottom.
@@ -165,7 +47,7 @@ end
 bottom = {}
 bottom.name = "tilebottom"
 function bottom.arrange(p)
-    return tile(p, "bottom")
+    return tile(p, "tilebottom")
 end
 
 --- The main tile algo, on top.
@@ -173,7 +55,7 @@ end
 top = {}
 top.name = "tiletop"
 function top.arrange(p)
-    return tile(p, "top")
+    return tile(p, "tiletop")
 end
 
 arrange = right.arrange
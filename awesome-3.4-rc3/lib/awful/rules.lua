@@ -6,6 +6,10 @@
 
 -- Grab environment we need
 local client = client
+local capi =
+{
+    awesome = awesome
+}
 local type = type
 local ipairs = ipairs
 local pairs = pairs
@@ -52,11 +56,16 @@ module("awful.rules")
 -- <p>If a client matches multiple rules, their applied in the order they are
 -- put in this global rules table. If the value of a rule is a string, then the
 -- match function is used to determine if the client matches the rule.</p>
+-- <p>Rules are compiled again whenever this table, one of its entries or
+-- one of their rule tables is replaced or modified.</p>
 --
 -- @class table
 -- @name rules
 rules = {}
 
+-- The compiled rules.
+local compiled
+
 --- Check if a client match a rule.
 -- @param c The client.
 -- @param rule The rule to check.
@@ -78,36 +87,47 @@ function match(c, rule)
     return true
 end
 
+--- Compile the rules table.
+-- This is done automatically when the rules table changes.
+function compile()
+    if not compiled then
+        compiled = capi.awesome.rules()
+    end
+    compiled:set(rules)
+end
+
 --- Apply rules to a client.
 -- @param c The client.
 function apply(c)
-    for _, entry in ipairs(rules) do
-        if match(c, entry.rule) then
-            for property, value in pairs(entry.properties) do
-                if property == "floating" then
-                    aclient.floating.set(c, value)
-                elseif property == "tag" then
-                    aclient.movetotag(value, c)
-                elseif property == "switchtotag" and value
-                    and entry.properties["tag"] then
-                    atag.viewonly(entry.properties["tag"])
-                elseif property == "height" or property == "width" or
-                       property == "x" or property == "y" then
-                    local geo = c:geometry();
-                    geo[property] = value
-                    c:geometry(geo);
-                elseif type(c[property]) == "function" then
-                    c[property](c, value)
-                else
-                    c[property] = value
-                end
-            end
-            -- Do this at last so we do not erase things done by the focus
-            -- signal.
-            if entry.properties.focus then
-                client.focus = c
+    if not compiled then
+        compile()
+    end
+    for _, i in ipairs(compiled:match(c, rules)) do
+        local entry = rules[i]
+        for property, value in pairs(entry.properties) do
+            if property == "floating" then
+                aclient.floating.set(c, value)
+            elseif property == "tag" then
+                aclient.movetotag(value, c)
+            elseif property == "switchtotag" and value
+                and entry.properties["tag"] then
+                atag.viewonly(entry.properties["tag"])
+            elseif property == "height" or property == "width" or
+                   property == "x" or property == "y" then
+                local geo = c:geometry();
+                geo[property] = value
+                c:geometry(geo);
+            elseif type(c[property]) == "function" then
+                c[property](c, value)
+            else
+                c[property] = value
             end
         end
+        -- Do this at last so we do not erase things done by the focus
+        -- signal.
+        if entry.properties.focus then
+            client.focus = c
+        end
     end
 end
 
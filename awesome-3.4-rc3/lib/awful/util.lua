@@ -89,6 +89,7 @@ function spawn_with_shell(cmd, screen)
 end
 
 --- Read a program output and returns its output as a string.
+-- Note that this blocks awesome until the program ends, see pread_async().
 -- @param cmd The command to run.
 -- @return A string with the program output, or the error if one occured.
 function pread(cmd)
@@ -104,6 +105,19 @@ function pread(cmd)
     end
 end
 
+--- Read a program output without waiting for it.
+-- @param cmd The command to run.
+-- @param callback A function called with the program output, or with nil and
+-- the error if one occured.
+function pread_async(cmd, callback)
+    if cmd and cmd ~= "" then
+        local pid, err = capi.awesome.spawn_async(cmd, { stdout = callback })
+        if not pid then
+            callback(nil, err)
+        end
+    end
+end
+
 --- Eval Lua code.
 -- @return The return value of Lua code.
 function eval(s)
@@ -6,6 +6,7 @@
 
 local setmetatable = setmetatable
 local ipairs = ipairs
+local type = type
 local math = math
 local table = table
 local capi = { image = image,
@@ -69,105 +70,192 @@ local properties = { "width", "height", "border_color", "offset",
                      "gradient_colors", "gradient_angle", "color",
                      "background_color", "max_value", "scale" }
 
-local function update(graph)
-    -- Create new empty image
-    local img = capi.image.argb32(data[graph].width, data[graph].height, nil)
+-- Values are kept in a ring indexed by sample number. The sample numbers of
+-- the decreasing values following the maximum are kept in a deque, so that
+-- neither adding a value nor finding the maximum goes through all the values.
+local function reset_values(graph)
+    data[graph].values = {}
+    data[graph].count = 0
+    data[graph].maxq = {}
+    data[graph].maxq_first = 1
+    data[graph].maxq_last = 0
+end
+
+local function push_value(graph, value)
+    local d = data[graph]
+    local size = d.width
+
+    d.count = d.count + 1
+    d.values[d.count % size] = value
+
+    -- The sample overwritten leaves the maximum deque
+    if d.maxq_first <= d.maxq_last and d.maxq[d.maxq_first] <= d.count - size then
+        d.maxq[d.maxq_first] = nil
+        d.maxq_first = d.maxq_first + 1
+    end
+
+    -- Drop the samples which can no longer be the maximum
+    while d.maxq_last >= d.maxq_first and d.values[d.maxq[d.maxq_last] % size] <= value do
+        d.maxq[d.maxq_last] = nil
+        d.maxq_last = d.maxq_last - 1
+    end
+
+    d.maxq_last = d.maxq_last + 1
+    d.maxq[d.maxq_last] = d.count
+end
 
+local function get_max_value(graph)
+    local d = data[graph]
+    if d.scale and d.maxq_first <= d.maxq_last then
+        return math.max(d.max_value, d.values[d.maxq[d.maxq_first] % d.width])
+    end
+    return d.max_value
+end
+
+local function get_border_width(graph)
     local border_width = 0
     if data[graph].border_color then
         border_width = 1
-	
-	if data[graph].offset then
+        if data[graph].offset then
             border_width = border_width + data[graph].offset
         end
     end
+    return border_width
+end
+
+-- Draw the background above a value in a column.
+local function draw_column(graph, img, x, value, max_value)
+    local d = data[graph]
+    local border_width = get_border_width(graph)
+    local height = d.height - 2 * border_width
+
+    if value >= 0 then
+        img:draw_line(x, border_width + (height * (1 - value / max_value)),
+                      x, border_width,
+                      d.background_color or "#000000aa")
+    end
+end
 
-    local values = data[graph].values
-    local max_value = data[graph].max_value
+local function draw_foreground(graph, img, x, width)
+    local d = data[graph]
+    local border_width = get_border_width(graph)
 
-    if data[graph].scale then
-        for _, v in ipairs(values) do
-            if v > max_value then
-                max_value = v
-            end
-        end
+    if d.gradient_colors then
+        img:draw_rectangle_gradient(x, border_width,
+                                    width, d.height - (2 * border_width),
+                                    d.gradient_colors,
+                                    d.gradient_angle or 270)
+    else
+        img:draw_rectangle(x, border_width,
+                           width, d.height - (2 * border_width),
+                           true, d.color or "red")
     end
+end
+
+local function draw_border(graph, img)
+    if data[graph].border_color then
+        img:draw_rectangle(0, 0, data[graph].width, data[graph].height,
+                           false, data[graph].border_color)
+    end
+end
+
+local function update(graph)
+    local d = data[graph]
+
+    -- Create a new image only if the size changed, otherwise make it blank
+    -- as a new one would be
+    local img = d.image
+    if not img or img.width ~= d.width or img.height ~= d.height then
+        img = capi.image.argb32(d.width, d.height, nil)
+        d.image = img
+    else
+        img:draw_rectangle(0, 0, d.width, d.height, true, "#000000")
+    end
+
+    local border_width = get_border_width(graph)
+    local columns = d.width - 2 * border_width
+    local max_value = get_max_value(graph)
+    local shown = math.min(d.count, columns)
 
     -- Draw background
     -- Draw full gradient
-    if data[graph].gradient_colors then
-        img:draw_rectangle_gradient(border_width, border_width,
-                                    data[graph].width - (2 * border_width),
-                                    data[graph].height - (2 * border_width),
-                                    data[graph].gradient_colors,
-                                    data[graph].gradient_angle or 270)
-    else
-        img:draw_rectangle(border_width, border_width,
-                           data[graph].width - (2 * border_width),
-                           data[graph].height - (2 * border_width),
-                           true, data[graph].color or "red")
-    end
-
-    -- No value? Draw nothing.
-    if #values ~= 0 then
-        -- Draw reverse
-        for i = 0, #values - 1 do
-            local value = values[#values - i]
-            if value >= 0 then
-                value = value / max_value
-                img:draw_line(data[graph].width - border_width - i - 1,
-                              border_width + ((data[graph].height - 2 * border_width) * (1 - value)),
-                              data[graph].width - border_width - i - 1,
-                              border_width,
-                              data[graph].background_color or "#000000aa")
-            end
-        end
+    draw_foreground(graph, img, border_width, columns)
+
+    -- Draw reverse
+    for i = 0, shown - 1 do
+        draw_column(graph, img, d.width - border_width - i - 1,
+                    d.values[(d.count - i) % d.width], max_value)
     end
 
     -- If we did not draw values everywhere, draw a square over the last left
     -- part to set everything to 0 :-)
-    if #values < data[graph].width - (2 * border_width) then
+    if shown < columns then
         img:draw_rectangle(border_width, border_width,
-                           data[graph].width - (2 * border_width) - #values,
-                           data[graph].height - (2 * border_width),
-                           true, data[graph].background_color or "#000000aa")
+                           columns - shown,
+                           d.height - (2 * border_width),
+                           true, d.background_color or "#000000aa")
     end
 
     -- Draw the border last so that it overlaps other stuff
-    if data[graph].border_color then
-        -- Draw border
-        img:draw_rectangle(0, 0, data[graph].width, data[graph].height,
-                           false, data[graph].border_color or "white")
-    end
+    draw_border(graph, img)
+
+    d.drawn_max_value = max_value
 
     -- Update the image
     graph.widget.image = img
 end
 
+-- Scroll the graph by the values added since it was drawn, and only draw the
+-- new columns. Everything is redrawn if the scale changed, or if the colors
+-- depend on the column.
+local function scroll(graph, added)
+    local d = data[graph]
+    local border_width = get_border_width(graph)
+    local columns = d.width - 2 * border_width
+    local max_value = get_max_value(graph)
+
+    if not d.image or d.drawn_max_value ~= max_value or added >= columns
+        or d.count - added < columns
+        or (d.gradient_colors and (d.gradient_angle or 270) % 180 ~= 0) then
+        return update(graph)
+    end
+
+    local img = d.image
+    local x = d.width - border_width - added
+
+    img:scroll(- added, 0, border_width, border_width,
+               columns, d.height - 2 * border_width)
+    img:draw_rectangle(x, border_width, added, d.height - 2 * border_width,
+                       true, "#000000")
+    draw_foreground(graph, img, x, added)
+    for i = 0, added - 1 do
+        draw_column(graph, img, x + i, d.values[(d.count - added + 1 + i) % d.width], max_value)
+    end
+
+    graph.widget.image = img
+end
+
 --- Add a value to the graph
 -- @param graph The graph.
--- @param value The value between 0 and 1.
+-- @param value The value between 0 and 1, or a table of values to add in
+-- order.
 local function add_value(graph, value)
     if not graph then return end
 
-    local value = value or 0
-    local max_value = data[graph].max_value
-    value = math.max(0, value)
-    if not data[graph].scale then
-        value = math.min(max_value, value)
+    local values = value
+    if type(values) ~= "table" then
+        values = { value or 0 }
     end
 
-    table.insert(data[graph].values, value)
-
-    local border_width = 0
-    if data[graph].border then border_width = 2 end
-
-    -- Ensure we never have more data than we can draw
-    while #data[graph].values > data[graph].width - border_width do
-        table.remove(data[graph].values, 1)
+    for _, v in ipairs(values) do
+        v = math.max(0, v)
+        if not data[graph].scale then
+            v = math.min(data[graph].max_value, v)
+        end
+        push_value(graph, v)
     end
 
-    update(graph)
+    scroll(graph, #values)
     return graph
 end
 
@@ -188,7 +276,17 @@ end
 -- @param width The width to set.
 function set_width(graph, width)
     if width >= 5 then
-        data[graph].width = width
+        -- Keep the last values in a ring of the new size
+        local d = data[graph]
+        local values = {}
+        for i = math.max(1, d.count - math.min(d.width, width) + 1), d.count do
+            table.insert(values, d.values[i % d.width])
+        end
+        d.width = width
+        reset_values(graph)
+        for _, v in ipairs(values) do
+            push_value(graph, v)
+        end
         update(graph)
     end
     return graph
@@ -233,7 +331,8 @@ function new(args)
     graph.widget = capi.widget(args)
     graph.widget.resize = false
 
-    data[graph] = { width = width, height = height, values = {}, max_value = 1 }
+    data[graph] = { width = width, height = height, max_value = 1 }
+    reset_values(graph)
 
     -- Set methods
     graph.add_value = add_value
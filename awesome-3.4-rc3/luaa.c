@@ -32,6 +32,7 @@
 #include "awesome.h"
 #include "config.h"
 #include "timer.h"
+#include "rules.h"
 #include "awesome-version-internal.h"
 #include "ewmh.h"
 #include "luaa.h"
@@ -40,7 +41,6 @@
 #include "client.h"
 #include "screen.h"
 #include "event.h"
-#include "selection.h"
 #include "window.h"
 #include "common/xcursor.h"
 #include "common/buffer.h"
@@ -54,6 +54,8 @@ extern const struct luaL_reg awesome_mousegrabber_lib[];
 extern const struct luaL_reg awesome_root_lib[];
 extern const struct luaL_reg awesome_mouse_methods[];
 extern const struct luaL_reg awesome_mouse_meta[];
+extern const struct luaL_reg awesome_selection_methods[];
+extern const struct luaL_reg awesome_selection_meta[];
 extern const struct luaL_reg awesome_screen_methods[];
 extern const struct luaL_reg awesome_screen_meta[];
 
@@ -283,10 +285,6 @@ luaA_fixups(lua_State *L)
     lua_pushliteral(L, "type");
     lua_pushcfunction(L, luaAe_type);
     lua_settable(L, LUA_GLOBALSINDEX);
-    /* set selection */
-    lua_pushliteral(L, "selection");
-    lua_pushcfunction(L, luaA_selection_get);
-    lua_settable(L, LUA_GLOBALSINDEX);
 }
 
 /** __next function for wtable objects.
@@ -574,6 +572,12 @@ luaA_awesome_index(lua_State *L)
       case A_TK_RELEASE:
         lua_pushliteral(L, AWESOME_RELEASE);
         break;
+      case A_TK_IMAGE_CACHE_SIZE:
+        lua_pushnumber(L, image_cache_getsize());
+        break;
+      case A_TK_ICON_SIZE:
+        lua_pushnumber(L, ewmh_icon_size_get());
+        break;
       default:
         return 0;
     }
@@ -617,6 +621,12 @@ luaA_awesome_newindex(lua_State *L)
         if((buf = luaL_checklstring(L, 3, &len)))
            xcolor_init_reply(xcolor_init_unchecked(&globalconf.colors.bg, buf, len));
         break;
+      case A_TK_IMAGE_CACHE_SIZE:
+        image_cache_setsize(MAX(luaL_checknumber(L, 3), 0));
+        break;
+      case A_TK_ICON_SIZE:
+        ewmh_icon_size_set(MAX(luaL_checknumber(L, 3), 0));
+        break;
       default:
         return 0;
     }
@@ -672,6 +682,23 @@ luaA_awesome_emit_signal(lua_State *L)
     return 0;
 }
 
+/** Set whether the emissions of a signal should be coalesced.
+ * A coalesced signal emitted without arguments is queued, and its functions
+ * are called once per object at the end of the main loop iteration.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lparam A string with the event name.
+ * \lparam Optional boolean, false to stop coalescing the signal.
+ */
+static int
+luaA_awesome_coalesce_signal(lua_State *L)
+{
+    const char *name = luaL_checkstring(L, 1);
+    signal_coalesce(name, luaA_optboolean(L, 2, true));
+    return 0;
+}
+
 static int
 luaA_panic(lua_State *L)
 {
@@ -714,10 +741,12 @@ luaA_init(xdgHandle* xdg)
         { "quit", luaA_quit },
         { "exec", luaA_exec },
         { "spawn", luaA_spawn },
+        { "spawn_async", luaA_spawn_async },
         { "restart", luaA_restart },
         { "add_signal", luaA_awesome_add_signal },
         { "remove_signal", luaA_awesome_remove_signal },
         { "emit_signal", luaA_awesome_emit_signal },
+        { "coalesce_signal", luaA_awesome_coalesce_signal },
         { "__index", luaA_awesome_index },
         { "__newindex", luaA_awesome_newindex },
         { NULL, NULL }
@@ -768,6 +797,9 @@ luaA_init(xdgHandle* xdg)
     /* Export mouse */
     luaA_openlib(L, "mouse", awesome_mouse_methods, awesome_mouse_meta);
 
+    /* Export selection */
+    luaA_openlib(L, "selection", awesome_selection_methods, awesome_selection_meta);
+
     /* Export button */
     button_class_setup(L);
 
@@ -792,6 +824,9 @@ luaA_init(xdgHandle* xdg)
     /* Export timer */
     timer_class_setup(L);
 
+    /* Export rules, as awesome.rules */
+    rules_class_setup(L);
+
     /* init hooks */
     globalconf.hooks.manage = LUA_REFNIL;
     globalconf.hooks.unmanage = LUA_REFNIL;
@@ -11,6 +11,11 @@ module("awesome")
 -- @field version The version of awesome.
 -- #field release The release name of awesome.
 -- @field conffile The configuration file which has been loaded.
+-- @field image_cache_size Memory in bytes used to keep images on the X server
+-- so they are not sent again each time they are drawn, 8 MiB by default.
+-- @field icon_size Size of the client icons read from _NET_WM_ICON, 32 by
+-- default. The closest size the application provides is used and downscaled if
+-- needed. Set to 0 to keep the largest icons.
 -- @class table
 -- @name awesome
 
@@ -36,6 +41,20 @@ module("awesome")
 -- @param screen Optional screen number to spawn the command on.
 -- @return Nothing is everything is OK, or an error string if an error occured.
 
+--- Spawn a program without waiting for it.
+-- The output and exit status of the program are given to functions when
+-- available, without blocking awesome.
+-- @param cmd The command to launch.
+-- @param callbacks Optional table with the following fields:
+-- <code>stdout</code> and <code>stderr</code>, functions called with the
+-- output of the program, <code>exit</code>, a function called with "exit" and
+-- the exit code or "signal" and the signal number when the program
+-- terminates, and <code>lines</code>, a boolean to get the output line by line
+-- rather than all at once when the program closes it.
+-- @return The process id, or nil and an error string if an error occured.
+-- @name spawn_async
+-- @class function
+
 --- Add a global signal.
 -- @param name A string with the event name.
 -- @param func The function to call.
@@ -53,3 +72,11 @@ module("awesome")
 -- @param ... Signal arguments.
 -- @name emit_signal
 -- @class function
+
+--- Coalesce the emissions of a signal without arguments: its functions are
+-- called once per object at the end of the main loop iteration, however many
+-- times it has been emitted.
+-- @param name A string with the event name.
+-- @param coalesce Optional boolean, false to stop coalescing the signal.
+-- @name coalesce_signal
+-- @class function
@@ -111,6 +111,14 @@ module("client")
 -- @name redraw
 -- @class function
 
+--- Capture the client content without blocking.
+-- The capture goes through shared memory when the X server supports it.
+-- @param callback A function called with the image, or nil if the capture failed.
+-- @param width Optional maximum width, the image is downscaled to fit in it.
+-- @param height Optional maximum height, the image is downscaled to fit in it.
+-- @name content_async
+-- @class function
+
 --- Stop managing a client.
 -- @param -
 -- @name unmanage
@@ -111,6 +111,17 @@ module("image")
 -- @name insert
 -- @class function
 
+--- Scroll the content of an image, or of a part of it. The area uncovered
+-- keeps its previous content.
+-- @param dx The horizontal offset, positive to scroll right.
+-- @param dy The vertical offset, positive to scroll down.
+-- @param x The x coordinate of the area to scroll (optional).
+-- @param y The y coordinate of the area to scroll (optional).
+-- @param width The width of the area to scroll (optional).
+-- @param height The height of the area to scroll (optional).
+-- @name scroll
+-- @class function
+
 --- Add a signal.
 -- @param name A signal name.
 -- @param func A function to call when the signal is emitted.
@@ -10,6 +10,8 @@ module("key")
 -- @field modifiers The modifier key that should be pressed while the key is
 -- pressed. An array with all the modifiers. Valid modifiers are: Any, Mod1,
 -- Mod2, Mod3, Mod4, Mod5, Shift, Lock and Control.
+-- @field ignore_locks True if the key should be triggered whatever the state of
+-- Caps Lock, Shift Lock and Num Lock. Defaults to false.
 -- @class table
 -- @name key
 
@@ -0,0 +1,43 @@
+--- awesome rules API, used by awful.rules
+-- @author agent &lt;agent@local&gt;
+-- @copyright 2026 agent
+module("awesome.rules")
+
+--- Rules object. This type of object holds a compiled copy of a rules table,
+-- in the format used by awful.rules, and matches clients against it.
+-- Rules asking for an exact class or instance (i.e. "^xterm$") are indexed
+-- and only checked against clients having this class or instance.
+-- @class table
+-- @name rules
+
+--- Compile a new rules table, replacing the previous one.
+-- @param rules A table of { rule = {...}, properties = {...} } entries.
+-- @name set
+-- @class function
+
+--- Match a client against all the rules.
+-- @param c A client.
+-- @param rules An optional rules table. The rules are compiled again from it
+-- if it is not the table they were compiled from, or if it, one of its
+-- entries or one of their rule tables has been modified since.
+-- @return A table with the indexes of the matching rules, in order.
+-- @name match
+-- @class function
+
+--- Add a signal.
+-- @param name A signal name.
+-- @param func A function to call when the signal is emitted.
+-- @name add_signal
+-- @class function
+
+--- Remove a signal.
+-- @param name A signal name.
+-- @param func A function to remove.
+-- @name remove_signal
+-- @class function
+
+--- Emit a signal.
+-- @param name A signal name.
+-- @param ... Various arguments, optional.
+-- @name emit_signal
+-- @class function
@@ -40,3 +40,22 @@ module("screen")
 -- The table must contains at least one tag.
 -- @name tags
 -- @class function
+
+--- Resize clients in one pass. All windows are configured at once, and each
+-- client emits its geometry signals only once, after all of them moved.
+-- @param geometries A table with clients as keys and the geometries to give
+-- them as values.
+-- @return A table with clients as keys and their resulting geometries as values.
+-- @name arrange_batch
+-- @class function
+
+--- Arrange clients with one of the built-in layouts, applying all the
+-- geometries in one pass as arrange_batch does.
+-- @param name The layout name: tile, tileleft, tilebottom, tiletop, fairv,
+-- fairh, max, fullscreen or magnifier.
+-- @param params A table with the clients to arrange, and optionally the
+-- workarea, the screen geometry (for fullscreen), the mwfact, nmaster and
+-- ncol values, the windowfact table of the tag and the focused client (for
+-- magnifier).
+-- @name arrange_layout
+-- @class function
@@ -8,3 +8,19 @@ module("selection")
 -- @return A string with the selection (clipboard) content.
 -- @name selection
 -- @class function
+
+--- Get the content of a selection without blocking.
+-- The selection owner is asked to send the selection and the function
+-- returns at once. Large selections sent in several chunks (INCR) are
+-- supported.
+-- @param callback A function called with the selection content, or nil if
+-- the selection is empty, cannot be converted or the owner did not answer in
+-- time.
+-- @param selection Optional selection name, i.e. "CLIPBOARD". Default is
+-- "PRIMARY".
+-- @param target Optional target to convert the selection to. Default is
+-- "UTF8_STRING".
+-- @param timeout Optional time to wait for each answer of the owner, in
+-- seconds. Default is 5.
+-- @name get_async
+-- @class function
@@ -25,6 +25,8 @@ module("wibox")
 -- @field height The height of the wibox.
 -- @field shape_bounding Image describing the window's border shape.
 -- @field shape_clip Image describing the window's content shape.
+-- @field fps Maximum number of redraws per second, 0 for no limit.
+-- @field vsync Round the time between redraws to whole refresh periods of the screen.
 -- @class table
 -- @name wibox
 
@@ -46,6 +48,12 @@ module("wibox")
 -- @name geometry
 -- @class function
 
+--- Get the redraw statistics of a wibox.
+-- @return The number of times the wibox needed a redraw, and the number of
+-- redraws actually done.
+-- @name redraws
+-- @class function
+
 --- Add a signal.
 -- @param name A signal name.
 -- @param func A function to call when the signal is emitted.
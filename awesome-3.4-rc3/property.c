@@ -28,6 +28,7 @@
 #include "wibox.h"
 #include "window.h"
 #include "luaa.h"
+#include "selection.h"
 #include "common/atoms.h"
 #include "common/xutil.h"
 
@@ -261,15 +262,27 @@ void
 property_update_net_wm_icon(client_t *c,
                             xcb_get_property_reply_t *reply)
 {
+    uint64_t hash;
+    int pushed;
+
     luaA_object_push(globalconf.L, c);
 
     if(reply)
+        pushed = ewmh_window_icon_from_reply(reply, &hash);
+    else
+        pushed = ewmh_window_icon_get_reply(ewmh_window_icon_get_unchecked(c->window), &hash);
+
+    if(pushed)
     {
-        if(ewmh_window_icon_from_reply(reply))
+        /* Do not touch the icon if its content did not change */
+        if(hash == c->icon_hash)
+            lua_pop(globalconf.L, 1);
+        else
+        {
             client_set_icon(globalconf.L, -2, -1);
+            c->icon_hash = hash;
+        }
     }
-    else if(ewmh_window_icon_get_reply(ewmh_window_icon_get_unchecked(c->window)))
-        client_set_icon(globalconf.L, -2, -1);
 
     /* remove client */
     lua_pop(globalconf.L, 1);
@@ -314,8 +327,13 @@ property_update_wm_protocols(client_t *c, xcb_get_property_reply_t *reply)
 
     if(reply)
     {
+        /* The protocols keep a pointer to the reply, which is not ours. */
+        reply = xmemdup(reply, sizeof(*reply) + reply->length * 4);
         if(!xcb_get_wm_protocols_from_reply(reply, &protocols))
+        {
+            p_delete(&reply);
             return;
+        }
     }
     else
     {
@@ -331,6 +349,76 @@ property_update_wm_protocols(client_t *c, xcb_get_property_reply_t *reply)
     memcpy(&c->protocols, &protocols, sizeof(protocols));
 }
 
+/** Send the requests for all the properties read when managing a window,
+ * without waiting for any reply.
+ * The window is first selected for property changes, so that none happening
+ * after the requests is lost.
+ * \param w The window.
+ * \param cookies The cookies to fill.
+ */
+void
+property_cookies_send(xcb_window_t w, property_cookies_t *cookies)
+{
+    const uint32_t select_input_val[] = { CLIENT_SELECT_INPUT_EVENT_MASK };
+    xcb_connection_t *conn = globalconf.connection;
+
+    xcb_change_window_attributes(conn, w, XCB_CW_EVENT_MASK, select_input_val);
+
+    cookies->wm_normal_hints = xcb_get_wm_normal_hints_unchecked(conn, w);
+    cookies->wm_hints = xcb_get_wm_hints_unchecked(conn, w);
+    cookies->wm_transient_for = xcb_get_wm_transient_for_unchecked(conn, w);
+    cookies->wm_client_leader = xcb_get_property_unchecked(conn, false, w,
+                                                           WM_CLIENT_LEADER, WINDOW, 0, 32);
+    cookies->wm_client_machine = xcb_get_any_property(conn, false, w,
+                                                      WM_CLIENT_MACHINE, UINT_MAX);
+    cookies->wm_window_role = xcb_get_any_property(conn, false, w,
+                                                   WM_WINDOW_ROLE, UINT_MAX);
+    cookies->net_wm_pid = xcb_get_property_unchecked(conn, false, w,
+                                                     _NET_WM_PID, CARDINAL, 0L, 1L);
+    cookies->net_wm_icon = ewmh_window_icon_get_unchecked(w);
+    cookies->net_wm_window_opacity = xcb_get_property_unchecked(conn, false, w,
+                                                                _NET_WM_WINDOW_OPACITY, CARDINAL, 0L, 1L);
+    cookies->wm_name = xcb_get_any_property(conn, false, w, WM_NAME, UINT_MAX);
+    cookies->net_wm_name = xcb_get_any_property(conn, false, w, _NET_WM_NAME, UINT_MAX);
+    cookies->wm_icon_name = xcb_get_any_property(conn, false, w, WM_ICON_NAME, UINT_MAX);
+    cookies->net_wm_icon_name = xcb_get_any_property(conn, false, w, _NET_WM_ICON_NAME, UINT_MAX);
+    cookies->wm_class = xcb_get_wm_class_unchecked(conn, w);
+    cookies->wm_protocols = xcb_get_wm_protocols_unchecked(conn, w, WM_PROTOCOLS);
+    cookies->net_wm_strut_partial = xcb_get_property_unchecked(conn, false, w,
+                                                               _NET_WM_STRUT_PARTIAL, CARDINAL, 0, 12);
+}
+
+/** Throw away the replies of requests sent by property_cookies_send().
+ * \param cookies The cookies.
+ */
+void
+property_cookies_discard(property_cookies_t *cookies)
+{
+    xcb_get_property_cookie_t *cookie = (xcb_get_property_cookie_t *) cookies;
+
+    for(size_t i = 0; i < sizeof(*cookies) / sizeof(*cookie); i++)
+        xcb_discard_reply(globalconf.connection, cookie[i].sequence);
+}
+
+/** Update a client property from the reply of a request already sent.
+ * \param c The client.
+ * \param cookie The request cookie.
+ * \param update The function updating the property from the reply.
+ */
+void
+property_update_from_cookie(client_t *c, xcb_get_property_cookie_t cookie,
+                            property_update_t *update)
+{
+    xcb_get_property_reply_t *reply =
+        xcb_get_property_reply(globalconf.connection, cookie, NULL);
+
+    if(reply)
+    {
+        update(c, reply);
+        p_delete(&reply);
+    }
+}
+
 /** The property notify event handler.
  * \param data currently unused.
  * \param connection The connection to the X server.
@@ -363,6 +451,8 @@ property_handle_xrootpmap_id(void *data __attribute__ ((unused)),
                              xcb_atom_t name,
                              xcb_get_property_reply_t *reply)
 {
+    widget_rootpixmap_update(xutil_root2screen(connection, window), reply);
+
     if(globalconf.xinerama_is_active)
         foreach(w, globalconf.wiboxes)
             (*w)->need_update = true;
@@ -455,6 +545,10 @@ void a_xcb_set_property_handlers(void)
     /* background change */
     xcb_property_set_handler(&globalconf.prophs, _XROOTPMAP_ID, 1,
                              property_handle_xrootpmap_id, NULL);
+
+    /* Incremental selection transfers, chunks are read by the handler */
+    xcb_property_set_handler(&globalconf.prophs, _AWESOME_SELECTION, 0,
+                             selection_handle_property, NULL);
 }
 
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
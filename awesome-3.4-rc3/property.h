@@ -24,6 +24,29 @@
 
 #include "globalconf.h"
 
+/** Requests for the properties read when a window gets managed */
+typedef struct
+{
+    xcb_get_property_cookie_t wm_normal_hints;
+    xcb_get_property_cookie_t wm_hints;
+    xcb_get_property_cookie_t wm_transient_for;
+    xcb_get_property_cookie_t wm_client_leader;
+    xcb_get_property_cookie_t wm_client_machine;
+    xcb_get_property_cookie_t wm_window_role;
+    xcb_get_property_cookie_t net_wm_pid;
+    xcb_get_property_cookie_t net_wm_icon;
+    xcb_get_property_cookie_t net_wm_window_opacity;
+    xcb_get_property_cookie_t wm_name;
+    xcb_get_property_cookie_t net_wm_name;
+    xcb_get_property_cookie_t wm_icon_name;
+    xcb_get_property_cookie_t net_wm_icon_name;
+    xcb_get_property_cookie_t wm_class;
+    xcb_get_property_cookie_t wm_protocols;
+    xcb_get_property_cookie_t net_wm_strut_partial;
+} property_cookies_t;
+
+typedef void (property_update_t)(client_t *, xcb_get_property_reply_t *);
+
 void property_update_wm_transient_for(client_t *, xcb_get_property_reply_t *);
 void property_update_wm_client_leader(client_t *c, xcb_get_property_reply_t *);
 void property_update_wm_normal_hints(client_t *, xcb_get_property_reply_t *);
@@ -38,6 +61,9 @@ void property_update_wm_client_machine(client_t *, xcb_get_property_reply_t *);
 void property_update_wm_window_role(client_t *, xcb_get_property_reply_t *);
 void property_update_net_wm_pid(client_t *, xcb_get_property_reply_t *);
 void property_update_net_wm_icon(client_t *, xcb_get_property_reply_t *);
+void property_cookies_send(xcb_window_t, property_cookies_t *);
+void property_cookies_discard(property_cookies_t *);
+void property_update_from_cookie(client_t *, xcb_get_property_cookie_t, property_update_t *);
 void a_xcb_set_property_handlers(void);
 
 #endif
@@ -128,15 +128,23 @@ luaA_root_keys(lua_State *L)
         while(lua_next(L, 1))
             key_array_append(&globalconf.keys, luaA_object_ref_class(L, -1, &key_class));
 
+        key_index_reset(&globalconf.keys_index);
+
+        key_grab_array_t grabs;
+        key_grab_array_init(&grabs);
+        key_array_grabs(&globalconf.keys, &grabs);
+
         int nscreen = xcb_setup_roots_length(xcb_get_setup(globalconf.connection));
 
         for(int phys_screen = 0; phys_screen < nscreen; phys_screen++)
         {
             xcb_screen_t *s = xutil_screen_get(globalconf.connection, phys_screen);
-            xcb_ungrab_key(globalconf.connection, XCB_GRAB_ANY, s->root, XCB_BUTTON_MASK_ANY);
-            window_grabkeys(s->root, &globalconf.keys);
+            window_grabkeys(s->root, &globalconf.keys_grabs, &grabs);
         }
 
+        key_grab_array_wipe(&globalconf.keys_grabs);
+        globalconf.keys_grabs = grabs;
+
         return 1;
     }
 
@@ -0,0 +1,717 @@
+/*
+ * rules.c - client rules matching
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <string.h>
+
+#include "globalconf.h"
+#include "luaa.h"
+#include "rules.h"
+#include "client.h"
+#include "common/luaobject.h"
+
+/** Characters having a special meaning in a Lua pattern. */
+#define RULES_PATTERN_SPECIALS "^$*+?.([%-"
+
+/** How a rule value is compared to a client property */
+typedef enum
+{
+    /** Compare with ==, the rule value is neither a string nor a number */
+    RULE_MATCH_EQUAL,
+    /** The rule value is a plain string: look for it in the property */
+    RULE_MATCH_FIND,
+    /** The rule value is an anchored plain string: compare it */
+    RULE_MATCH_EXACT,
+    /** The rule value is a real Lua pattern */
+    RULE_MATCH_PATTERN
+} rule_match_t;
+
+typedef struct
+{
+    /** The client property name */
+    char *field;
+    /** How to compare the property */
+    rule_match_t match;
+    /** The rule value, if it is a string or a number */
+    char *string;
+    /** The plain string to look for with FIND and EXACT */
+    char *literal;
+} rule_matcher_t;
+
+static void
+rule_matcher_wipe(rule_matcher_t *matcher)
+{
+    p_delete(&matcher->field);
+    p_delete(&matcher->string);
+    p_delete(&matcher->literal);
+}
+
+DO_ARRAY(rule_matcher_t, rule_matcher, rule_matcher_wipe)
+
+typedef struct
+{
+    /** The compiled rule */
+    rule_matcher_array_t matchers;
+    /** True if the rule can never match */
+    bool never;
+    /** The rule entry, NULL if it is not a table */
+    void *entry;
+    /** The rule table of the entry, NULL if it has none */
+    void *rule;
+    /** A copy of the rule table, to notice when it is modified */
+    void *copy;
+    /** Number of fields of the rule table */
+    int nfields;
+    /** True if the entry has a properties table */
+    bool has_properties;
+} rule_t;
+
+static void
+rule_wipe(rule_t *rule)
+{
+    rule_matcher_array_wipe(&rule->matchers);
+}
+
+DO_ARRAY(rule_t, rule, rule_wipe)
+DO_ARRAY(int, rule_index, DO_NOTHING)
+
+typedef struct
+{
+    /** Hash of the exact value the rules want */
+    unsigned long id;
+    /** Index of the rules */
+    rule_index_array_t rules;
+} rule_bucket_t;
+
+static int
+rule_bucket_cmp(const void *a, const void *b)
+{
+    const rule_bucket_t *x = a, *y = b;
+    return x->id > y->id ? 1 : (x->id < y->id ? -1 : 0);
+}
+
+static void
+rule_bucket_wipe(rule_bucket_t *bucket)
+{
+    rule_index_array_wipe(&bucket->rules);
+}
+
+DO_BARRAY(rule_bucket_t, rule_bucket, rule_bucket_wipe, rule_bucket_cmp)
+
+typedef struct
+{
+    LUA_OBJECT_HEADER
+    /** The rules table the rules were compiled from */
+    void *table;
+    /** Compiled rules, one per entry of the table, in order */
+    rule_array_t rules;
+    /** Rules wanting an exact class */
+    rule_bucket_array_t by_class;
+    /** Rules wanting an exact instance */
+    rule_bucket_array_t by_instance;
+    /** Rules that must always be checked */
+    rule_index_array_t others;
+} rules_t;
+
+static lua_class_t rules_class;
+LUA_OBJECT_FUNCS(rules_class, rules_t, rules)
+
+/** Compile a string rule value.
+ * \param matcher The matcher to fill.
+ * \param value The rule value.
+ * \param len The rule value length.
+ */
+static void
+rule_matcher_compile(rule_matcher_t *matcher, const char *value, size_t len)
+{
+    matcher->string = p_dup(value, len + 1);
+
+    /* Embedded zeros are left to string.match() */
+    if(a_strlen(value) != (ssize_t) len)
+        matcher->match = RULE_MATCH_PATTERN;
+    else if(!strpbrk(value, RULES_PATTERN_SPECIALS))
+    {
+        matcher->match = RULE_MATCH_FIND;
+        matcher->literal = p_dup(value, len + 1);
+    }
+    else if(len >= 2 && value[0] == '^' && value[len - 1] == '$')
+    {
+        char *literal = p_dup(value + 1, len - 1);
+        literal[len - 2] = '\0';
+        if(strpbrk(literal, RULES_PATTERN_SPECIALS))
+        {
+            p_delete(&literal);
+            matcher->match = RULE_MATCH_PATTERN;
+        }
+        else
+        {
+            matcher->match = RULE_MATCH_EXACT;
+            matcher->literal = literal;
+        }
+    }
+    else
+        matcher->match = RULE_MATCH_PATTERN;
+}
+
+/** Add a rule to a bucket.
+ * \param buckets The buckets array.
+ * \param key The value the rule wants.
+ * \param idx The rule index.
+ */
+static void
+rules_bucket_add(rule_bucket_array_t *buckets, const char *key, int idx)
+{
+    rule_bucket_t find = { .id = a_strhash((const unsigned char *) key) };
+    rule_bucket_t *bucket = rule_bucket_array_lookup(buckets, &find);
+
+    if(!bucket)
+    {
+        rule_bucket_array_insert(buckets, find);
+        bucket = rule_bucket_array_lookup(buckets, &find);
+    }
+
+    rule_index_array_append(&bucket->rules, idx);
+}
+
+/** Index the last rule added.
+ * \param rules The rules object.
+ */
+static void
+rules_index(rules_t *rules)
+{
+    int idx = rules->rules.len - 1;
+    rule_t *rule = &rules->rules.tab[idx];
+    rule_matcher_t *class = NULL, *instance = NULL;
+
+    if(rule->never)
+        return;
+
+    foreach(matcher, rule->matchers)
+        if(matcher->match == RULE_MATCH_EXACT)
+        {
+            if(!a_strcmp(matcher->field, "class"))
+                class = matcher;
+            else if(!a_strcmp(matcher->field, "instance"))
+                instance = matcher;
+        }
+
+    /* The raw value is indexed too since it's compared with == as well */
+    if(class)
+    {
+        rules_bucket_add(&rules->by_class, class->literal, idx);
+        rules_bucket_add(&rules->by_class, class->string, idx);
+    }
+    else if(instance)
+    {
+        rules_bucket_add(&rules->by_instance, instance->literal, idx);
+        rules_bucket_add(&rules->by_instance, instance->string, idx);
+    }
+    else
+        rule_index_array_append(&rules->others, idx);
+}
+
+/** Compile a rule entry and add it.
+ * Entries that cannot match are added too, so the rules keep the indexes
+ * of the entries.
+ * \param L The Lua VM state.
+ * \param rules The rules object.
+ * \param oud The rules object index on the stack.
+ * \param eud The rule entry index on the stack.
+ */
+static void
+rules_add(lua_State *L, rules_t *rules, int oud, int eud)
+{
+    rule_t rule;
+
+    p_clear(&rule, 1);
+    rule.never = true;
+
+    if(!lua_istable(L, eud))
+    {
+        luaA_warn(L, "rule entry %d is not a table, ignoring", rules->rules.len + 1);
+        rule_array_append(&rules->rules, rule);
+        return;
+    }
+
+    lua_pushvalue(L, eud);
+    rule.entry = luaA_object_ref_item(L, oud, -1);
+
+    lua_getfield(L, eud, "properties");
+    rule.has_properties = lua_istable(L, -1);
+    lua_pop(L, 1);
+
+    lua_getfield(L, eud, "rule");
+
+    if(!lua_istable(L, -1) || !rule.has_properties)
+    {
+        luaA_warn(L, "rule entry without rule or properties table, ignoring");
+        if(lua_istable(L, -1))
+            rule.rule = luaA_object_ref_item(L, oud, -1);
+        else
+            lua_pop(L, 1);
+        rule_array_append(&rules->rules, rule);
+        return;
+    }
+
+    rule.never = false;
+
+    /* The copy of the rule table */
+    lua_newtable(L);
+
+    lua_pushnil(L);
+    while(lua_next(L, -3))
+    {
+        lua_pushvalue(L, -2);
+        lua_pushvalue(L, -2);
+        lua_rawset(L, -5);
+        rule.nfields++;
+
+        /* A client has no such property, so this never matches */
+        if(lua_type(L, -2) != LUA_TSTRING)
+            rule.never = true;
+        else
+        {
+            rule_matcher_t matcher;
+            size_t len;
+
+            p_clear(&matcher, 1);
+            matcher.field = a_strdup(lua_tostring(L, -2));
+
+            switch(lua_type(L, -1))
+            {
+              case LUA_TSTRING:
+              case LUA_TNUMBER:
+                {
+                    const char *value = lua_tolstring(L, -1, &len);
+                    rule_matcher_compile(&matcher, value, len);
+                }
+                break;
+              default:
+                matcher.match = RULE_MATCH_EQUAL;
+                break;
+            }
+
+            rule_matcher_array_append(&rule.matchers, matcher);
+        }
+        lua_pop(L, 1);
+    }
+
+    rule.copy = luaA_object_ref_item(L, oud, -1);
+    rule.rule = luaA_object_ref_item(L, oud, -1);
+    rule_array_append(&rules->rules, rule);
+    rules_index(rules);
+}
+
+/** Check if a compiled rule is still the one of a rule entry.
+ * \param L The Lua VM state.
+ * \param rule The compiled rule.
+ * \param oud The rules object index on the stack.
+ * \param eud The rule entry index on the stack.
+ * \return True if the entry and its rule table did not change.
+ */
+static bool
+rule_isuptodate(lua_State *L, rule_t *rule, int oud, int eud)
+{
+    bool uptodate;
+    int nfields = 0;
+
+    if(!rule->entry)
+        return !lua_istable(L, eud);
+
+    luaA_object_push_item(L, oud, rule->entry);
+    uptodate = lua_rawequal(L, -1, eud);
+    lua_pop(L, 1);
+
+    if(!uptodate)
+        return false;
+
+    lua_getfield(L, eud, "properties");
+    uptodate = lua_istable(L, -1) == rule->has_properties;
+    lua_pop(L, 1);
+
+    if(!uptodate)
+        return false;
+
+    lua_getfield(L, eud, "rule");
+    luaA_object_push_item(L, oud, rule->rule);
+    uptodate = lua_rawequal(L, -1, -2);
+    lua_pop(L, 1);
+
+    /* Compare the rule table with its copy */
+    if(uptodate && rule->copy)
+    {
+        luaA_object_push_item(L, oud, rule->copy);
+        lua_pushnil(L);
+        while(uptodate && lua_next(L, -3))
+        {
+            nfields++;
+            lua_pushvalue(L, -2);
+            lua_rawget(L, -4);
+            uptodate = lua_rawequal(L, -1, -2);
+            lua_pop(L, 2);
+        }
+        /* lua_next() left the key if it stopped early */
+        if(!uptodate)
+            lua_pop(L, 1);
+        uptodate = uptodate && nfields == rule->nfields;
+        lua_pop(L, 1);
+    }
+
+    lua_pop(L, 1);
+
+    return uptodate;
+}
+
+/** Check if the rules of a rules object are still the ones of a table.
+ * \param L The Lua VM state.
+ * \param rules The rules object.
+ * \param oud The rules object index on the stack.
+ * \param tud The rules table index on the stack.
+ * \return True if nothing changed in the table since it was compiled.
+ */
+static bool
+rules_isuptodate(lua_State *L, rules_t *rules, int oud, int tud)
+{
+    bool uptodate;
+
+    luaA_object_push_item(L, oud, rules->table);
+    uptodate = lua_rawequal(L, -1, tud);
+    lua_pop(L, 1);
+
+    for(int i = 0; uptodate && i < rules->rules.len; i++)
+    {
+        lua_rawgeti(L, tud, i + 1);
+        uptodate = rule_isuptodate(L, &rules->rules.tab[i], oud, lua_gettop(L));
+        lua_pop(L, 1);
+    }
+
+    if(uptodate)
+    {
+        /* No entry has been appended */
+        lua_rawgeti(L, tud, rules->rules.len + 1);
+        uptodate = lua_isnil(L, -1);
+        lua_pop(L, 1);
+    }
+
+    return uptodate;
+}
+
+/** Drop all compiled rules.
+ * \param rules The rules object.
+ */
+static void
+rules_wipe(rules_t *rules)
+{
+    rule_array_wipe(&rules->rules);
+    rule_array_init(&rules->rules);
+    rule_bucket_array_wipe(&rules->by_class);
+    rule_bucket_array_init(&rules->by_class);
+    rule_bucket_array_wipe(&rules->by_instance);
+    rule_bucket_array_init(&rules->by_instance);
+    rule_index_array_wipe(&rules->others);
+    rule_index_array_init(&rules->others);
+}
+
+/** Replace the rules of a rules object.
+ * \param L The Lua VM state.
+ * \param rules The rules object.
+ * \param oud The rules object index on the stack.
+ * \param tud The rules table index on the stack, or none.
+ */
+static void
+rules_set(lua_State *L, rules_t *rules, int oud, int tud)
+{
+    foreach(rule, rules->rules)
+    {
+        luaA_object_unref_item(L, oud, rule->entry);
+        luaA_object_unref_item(L, oud, rule->rule);
+        luaA_object_unref_item(L, oud, rule->copy);
+    }
+    luaA_object_unref_item(L, oud, rules->table);
+    rules->table = NULL;
+
+    rules_wipe(rules);
+
+    if(lua_isnoneornil(L, tud))
+        return;
+
+    luaA_checktable(L, tud);
+
+    lua_pushvalue(L, tud);
+    rules->table = luaA_object_ref_item(L, oud, -1);
+
+    /* Stop at the first hole, like ipairs() */
+    for(int i = 1;; i++)
+    {
+        lua_rawgeti(L, tud, i);
+        if(lua_isnil(L, -1))
+        {
+            lua_pop(L, 1);
+            break;
+        }
+        rules_add(L, rules, oud, lua_gettop(L));
+        lua_pop(L, 1);
+    }
+}
+
+/** Mark the rules of the bucket matching a value.
+ * \param buckets The buckets array.
+ * \param key The client value.
+ * \param candidates The rules to check.
+ */
+static void
+rules_candidates_mark(rule_bucket_array_t *buckets, const char *key, bool *candidates)
+{
+    if(key)
+    {
+        rule_bucket_t find = { .id = a_strhash((const unsigned char *) key) };
+        rule_bucket_t *bucket = rule_bucket_array_lookup(buckets, &find);
+        if(bucket)
+            foreach(idx, bucket->rules)
+                candidates[*idx] = true;
+    }
+}
+
+/** Push a client property, fetching it only once per match.
+ * \param L The Lua VM state.
+ * \param cud The client index on the stack.
+ * \param vud The properties cache table index on the stack.
+ * \param field The property name.
+ */
+static void
+rules_client_value_push(lua_State *L, int cud, int vud, const char *field)
+{
+    lua_getfield(L, vud, field);
+    if(lua_isnil(L, -1))
+    {
+        lua_pop(L, 1);
+        lua_getfield(L, cud, field);
+        /* Store nil as false so we know we already looked for it */
+        if(lua_isnil(L, -1))
+        {
+            lua_pop(L, 1);
+            lua_pushboolean(L, false);
+        }
+        lua_pushvalue(L, -1);
+        lua_setfield(L, vud, field);
+    }
+}
+
+/** Check a client property against a compiled rule value.
+ * \param L The Lua VM state.
+ * \param matcher The matcher.
+ * \param cud The client index on the stack.
+ * \param vud The properties cache table index on the stack.
+ * \param rud The rule table index on the stack.
+ * \param fud The string.match function index on the stack.
+ * \return True if the property matches.
+ */
+static bool
+rule_matcher_check(lua_State *L, rule_matcher_t *matcher,
+                   int cud, int vud, int rud, int fud)
+{
+    bool ret = false;
+
+    rules_client_value_push(L, cud, vud, matcher->field);
+
+    if(!lua_toboolean(L, -1))
+        ret = false;
+    else if(lua_type(L, -1) == LUA_TSTRING)
+    {
+        const char *value = lua_tostring(L, -1);
+
+        switch(matcher->match)
+        {
+          case RULE_MATCH_EQUAL:
+            break;
+          case RULE_MATCH_FIND:
+            ret = strstr(value, matcher->literal);
+            break;
+          case RULE_MATCH_EXACT:
+            ret = !a_strcmp(value, matcher->literal) || !a_strcmp(value, matcher->string);
+            break;
+          case RULE_MATCH_PATTERN:
+            if(!(ret = !a_strcmp(value, matcher->string)))
+            {
+                lua_pushvalue(L, fud);
+                lua_pushvalue(L, -2);
+                lua_pushstring(L, matcher->string);
+                lua_call(L, 2, 1);
+                ret = lua_toboolean(L, -1);
+                lua_pop(L, 1);
+            }
+            break;
+        }
+    }
+    else
+    {
+        lua_getfield(L, rud, matcher->field);
+        ret = lua_equal(L, -1, -2);
+        lua_pop(L, 1);
+    }
+
+    lua_pop(L, 1);
+    return ret;
+}
+
+/** Create a new rules object.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lparam An optional rules table.
+ * \lreturn A new rules object.
+ */
+static int
+luaA_rules_new(lua_State *L)
+{
+    rules_t *rules = rules_new(L);
+    rules_set(L, rules, lua_gettop(L), 2);
+    return 1;
+}
+
+/** Compile a new rules table.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lparam A rules object.
+ * \lparam A rules table.
+ */
+static int
+luaA_rules_set(lua_State *L)
+{
+    rules_t *rules = luaA_checkudata(L, 1, &rules_class);
+    rules_set(L, rules, 1, 2);
+    return 0;
+}
+
+/** Match a client against all the rules.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lparam A rules object.
+ * \lparam A client.
+ * \lparam An optional rules table. The rules are compiled again from it if
+ * it is not the table they were compiled from, or if it has been modified
+ * since.
+ * \lreturn A table with the indexes of the matching rules, in order.
+ */
+static int
+luaA_rules_match(lua_State *L)
+{
+    rules_t *rules = luaA_checkudata(L, 1, &rules_class);
+    client_t *c = luaA_checkudata(L, 2, &client_class);
+
+    if(!lua_isnoneornil(L, 3))
+    {
+        luaA_checktable(L, 3);
+        if(!rules_isuptodate(L, rules, 1, 3))
+            rules_set(L, rules, 1, 3);
+    }
+
+    bool *candidates = p_alloca(bool, rules->rules.len + 1);
+
+    rules_candidates_mark(&rules->by_class, c->class, candidates);
+    rules_candidates_mark(&rules->by_instance, c->instance, candidates);
+    foreach(idx, rules->others)
+        candidates[*idx] = true;
+
+    lua_getglobal(L, "string");
+    lua_getfield(L, -1, "match");
+    lua_remove(L, -2);
+    int fud = lua_gettop(L);
+    /* Client properties already looked up */
+    lua_newtable(L);
+    int vud = lua_gettop(L);
+    /* Indexes of the matching rules */
+    lua_newtable(L);
+    int iud = lua_gettop(L);
+    int nmatch = 0;
+
+    for(int i = 0; i < rules->rules.len; i++)
+        if(candidates[i])
+        {
+            rule_t *rule = &rules->rules.tab[i];
+            bool match = true;
+
+            luaA_object_push_item(L, 1, rule->rule);
+            int rud = lua_gettop(L);
+            foreach(matcher, rule->matchers)
+                if(!(match = rule_matcher_check(L, matcher, 2, vud, rud, fud)))
+                    break;
+            lua_pop(L, 1);
+
+            if(match)
+            {
+                lua_pushnumber(L, i + 1);
+                lua_rawseti(L, iud, ++nmatch);
+            }
+        }
+
+    return 1;
+}
+
+static int
+luaA_rules_gc(lua_State *L)
+{
+    rules_t *rules = luaA_checkudata(L, 1, &rules_class);
+    rules_wipe(rules);
+    return luaA_object_gc(L);
+}
+
+void
+rules_class_setup(lua_State *L)
+{
+    static const struct luaL_reg rules_methods[] =
+    {
+        LUA_CLASS_METHODS(rules)
+        { "__call", luaA_rules_new },
+        { NULL, NULL }
+    };
+
+    static const struct luaL_reg rules_meta[] =
+    {
+        LUA_OBJECT_META(rules)
+            LUA_CLASS_META
+            { "set", luaA_rules_set },
+            { "match", luaA_rules_match },
+            { "__gc", luaA_rules_gc },
+            { NULL, NULL },
+    };
+
+    luaA_class_setup(L, &rules_class, "rules", (lua_class_allocator_t) rules_new,
+                     luaA_class_index_miss_property, luaA_class_newindex_miss_property,
+                     rules_methods, rules_meta);
+
+    /* The class is only there for awful.rules: keep it in the awesome table
+     * rather than in the globals, where it would hide a user module */
+    lua_getglobal(L, "awesome");
+    lua_pushliteral(L, "rules");
+    lua_getglobal(L, "rules");
+    lua_rawset(L, -3);
+    lua_pop(L, 1);
+    lua_pushnil(L);
+    lua_setglobal(L, "rules");
+    lua_getfield(L, LUA_REGISTRYINDEX, "_LOADED");
+    lua_pushnil(L);
+    lua_setfield(L, -2, "rules");
+    lua_pop(L, 1);
+}
+
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
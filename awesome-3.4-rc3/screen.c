@@ -31,6 +31,7 @@
 #include "widget.h"
 #include "wibox.h"
 #include "luaa.h"
+#include "layout.h"
 #include "common/xutil.h"
 
 static inline area_t
@@ -541,6 +542,258 @@ luaA_screen_count(lua_State *L)
     return 1;
 }
 
+/** Get the geometry asked for a client from a table, the missing values
+ * being the current ones.
+ * \param L The Lua VM state.
+ * \param idx The index of the table on the stack.
+ * \param c The client.
+ * \return The geometry.
+ */
+static area_t
+luaA_screen_checkgeometry(lua_State *L, int idx, client_t *c)
+{
+    area_t geometry;
+
+    luaA_checktable(L, idx);
+    geometry.x = luaA_getopt_number(L, idx, "x", c->geometry.x);
+    geometry.y = luaA_getopt_number(L, idx, "y", c->geometry.y);
+    geometry.width = luaA_getopt_number(L, idx, "width", c->geometry.width);
+    geometry.height = luaA_getopt_number(L, idx, "height", c->geometry.height);
+
+    return geometry;
+}
+
+/** Get an area from a field of a table.
+ * \param L The Lua VM state.
+ * \param idx The index of the table on the stack.
+ * \param name The field name.
+ * \param def The area to use if the field is not a table.
+ * \return The area.
+ */
+static area_t
+luaA_screen_getopt_area(lua_State *L, int idx, const char *name, area_t def)
+{
+    lua_getfield(L, idx, name);
+    if(lua_istable(L, -1))
+    {
+        int top = lua_gettop(L);
+        def.x = luaA_getopt_number(L, top, "x", def.x);
+        def.y = luaA_getopt_number(L, top, "y", def.y);
+        def.width = luaA_getopt_number(L, top, "width", def.width);
+        def.height = luaA_getopt_number(L, top, "height", def.height);
+    }
+    lua_pop(L, 1);
+    return def;
+}
+
+/** Resize clients in one pass.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lvalue A screen.
+ * \lparam A table with clients as keys and their new geometries as values.
+ * \lreturn A table with clients as keys and their resulting geometries as values.
+ */
+static int
+luaA_screen_arrange_batch(lua_State *L)
+{
+    int n = 0, i = 0;
+
+    luaL_checkudata(L, 1, "screen");
+    luaA_checktable(L, 2);
+
+    lua_pushnil(L);
+    while(lua_next(L, 2))
+    {
+        n++;
+        lua_pop(L, 1);
+    }
+
+    lua_createtable(L, 0, n);
+
+    if(!n)
+        return 1;
+
+    client_t *clients[n];
+    area_t geometries[n];
+
+    lua_pushnil(L);
+    while(lua_next(L, 2))
+    {
+        clients[i] = luaA_client_checkudata(L, -2);
+        geometries[i] = luaA_screen_checkgeometry(L, lua_gettop(L), clients[i]);
+        i++;
+        lua_pop(L, 1);
+    }
+
+    client_resize_batch(clients, geometries, n);
+
+    for(i = 0; i < n; i++)
+    {
+        luaA_object_push(L, clients[i]);
+        luaA_pusharea(L, geometries[i]);
+        lua_rawset(L, -3);
+    }
+
+    return 1;
+}
+
+/** Arrange clients with one of the tiling layouts, applying all the
+ * geometries in one pass.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lvalue A screen.
+ * \lparam The layout name: tile, tileleft, tilebottom, tiletop, fairv, fairh,
+ * max, fullscreen or magnifier.
+ * \lparam A table with the clients to arrange, and optionally the workarea,
+ * the screen geometry, the mwfact, nmaster and ncol of the tag, its
+ * windowfact table and the focused client.
+ * \lreturn For magnifier, the client put in the middle: the focused client,
+ * or the first client if the focused one is not arranged.
+ */
+static int
+luaA_screen_arrange_layout(lua_State *L)
+{
+    screen_t *s = luaL_checkudata(L, 1, "screen");
+    const char *name = luaL_checkstring(L, 2);
+    area_t wa;
+    int n;
+
+    luaA_checktable(L, 3);
+
+    wa = luaA_screen_getopt_area(L, 3, "workarea", screen_area_get(s, true));
+
+    lua_getfield(L, 3, "clients");
+    luaA_checktable(L, -1);
+    n = lua_objlen(L, -1);
+
+    if(!n)
+        return 0;
+
+    client_t *cls[n];
+    area_t geometries[n];
+
+    for(int i = 0; i < n; i++)
+    {
+        lua_rawgeti(L, -1, i + 1);
+        cls[i] = luaA_client_checkudata(L, -1);
+        geometries[i] = cls[i]->geometry;
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+
+    double mwfact = luaA_getopt_number(L, 3, "mwfact", 0.5);
+
+    if(!a_strcmp(name, "tile") || !a_strcmp(name, "tileleft")
+       || !a_strcmp(name, "tilebottom") || !a_strcmp(name, "tiletop"))
+    {
+        position_t position = Right;
+        int nmaster = luaA_getopt_number(L, 3, "nmaster", 1);
+        int ncol = luaA_getopt_number(L, 3, "ncol", 1);
+        nmaster = MAX(nmaster, 0);
+        int nother = n - MIN(nmaster, n);
+        /* Extra columns would be empty and leave the others unchanged */
+        int skip = MAX(ncol - nother, 0);
+
+        ncol = MAX(ncol - skip, 0);
+
+        if(!a_strcmp(name, "tileleft"))
+            position = Left;
+        else if(!a_strcmp(name, "tilebottom"))
+            position = Bottom;
+        else if(!a_strcmp(name, "tiletop"))
+            position = Top;
+
+        double facts_storage[(ncol + 1) * n];
+        double *facts[ncol + 1];
+
+        lua_getfield(L, 3, "windowfact");
+        bool has_windowfact = lua_istable(L, -1);
+        int wf = lua_gettop(L);
+
+        for(int col = 0; col <= ncol; col++)
+        {
+            facts[col] = facts_storage + col * n;
+            for(int i = 0; i < n; i++)
+                facts[col][i] = -1;
+
+            if(!has_windowfact)
+                continue;
+
+            lua_rawgeti(L, wf, col ? col + skip : 0);
+            if(lua_istable(L, -1))
+                for(int i = 0; i < n; i++)
+                {
+                    lua_rawgeti(L, -1, i + 1);
+                    if(lua_isnumber(L, -1))
+                        facts[col][i] = lua_tonumber(L, -1);
+                    lua_pop(L, 1);
+                }
+            lua_pop(L, 1);
+        }
+
+        layout_tile(cls, n, wa, position, mwfact, nmaster, ncol, facts, geometries);
+
+        /* Store the factors given to new clients, as awful.tag.incwfact
+         * expects them */
+        if(has_windowfact)
+            for(int col = 0; col <= ncol; col++)
+            {
+                lua_rawgeti(L, wf, col ? col + skip : 0);
+                if(!lua_istable(L, -1))
+                {
+                    lua_pop(L, 1);
+                    lua_newtable(L);
+                    lua_pushvalue(L, -1);
+                    lua_rawseti(L, wf, col ? col + skip : 0);
+                }
+                for(int i = 0; i < n; i++)
+                    if(facts[col][i] >= 0)
+                    {
+                        lua_pushnumber(L, facts[col][i]);
+                        lua_rawseti(L, -2, i + 1);
+                    }
+                lua_pop(L, 1);
+            }
+        lua_pop(L, 1);
+    }
+    else if(!a_strcmp(name, "fairv"))
+        layout_fair(cls, n, wa, South, geometries);
+    else if(!a_strcmp(name, "fairh"))
+        layout_fair(cls, n, wa, East, geometries);
+    else if(!a_strcmp(name, "max"))
+        layout_max(cls, n, wa, geometries);
+    else if(!a_strcmp(name, "fullscreen"))
+        layout_max(cls, n, luaA_screen_getopt_area(L, 3, "geometry", s->geometry), geometries);
+    else if(!a_strcmp(name, "magnifier"))
+    {
+        int focus = 0;
+
+        lua_getfield(L, 3, "focus");
+        if(!lua_isnil(L, -1))
+        {
+            client_t *c = luaA_client_checkudata(L, -1);
+            for(int i = 0; i < n; i++)
+                if(cls[i] == c)
+                    focus = i;
+        }
+        lua_pop(L, 1);
+
+        layout_magnifier(cls, n, focus, wa, mwfact, geometries);
+        client_resize_batch(cls, geometries, n);
+
+        luaA_object_push(L, cls[focus]);
+        return 1;
+    }
+    else
+        luaL_error(L, "unknown layout: %s", name);
+
+    client_resize_batch(cls, geometries, n);
+
+    return 0;
+}
+
 const struct luaL_reg awesome_screen_methods[] =
 {
     { "count", luaA_screen_count },
@@ -554,6 +807,8 @@ const struct luaL_reg awesome_screen_meta[] =
     { "remove_signal", luaA_screen_remove_signal },
     { "emit_signal", luaA_screen_emit_signal },
     { "tags", luaA_screen_tags },
+    { "arrange_batch", luaA_screen_arrange_batch },
+    { "arrange_layout", luaA_screen_arrange_layout },
     { "__index", luaA_screen_index },
     { NULL, NULL }
 };
@@ -24,6 +24,7 @@
 
 #include "globalconf.h"
 #include "draw.h"
+#include "tagmask.h"
 
 struct a_screen
 {
@@ -31,6 +32,8 @@ struct a_screen
     area_t geometry;
     /** Tag list */
     tag_array_t tags;
+    /** Selected tags of the list */
+    tag_mask_t selected_tags;
     /** Window that contains the systray */
     struct
     {
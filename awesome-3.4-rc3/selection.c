@@ -20,23 +20,58 @@
  *
  */
 
+#include <ev.h>
+
 #include <xcb/xcb_atom.h>
 
 #include "selection.h"
 #include "event.h"
+#include "luaa.h"
 #include "common/atoms.h"
+#include "common/buffer.h"
 #include "common/xutil.h"
 
+/** Default time to wait for a selection owner to answer, in seconds. */
+#define SELECTION_TIMEOUT 5.0
+
+/** An asynchronous selection request */
+typedef struct
+{
+    /** The selection to get */
+    xcb_atom_t selection;
+    /** The target to convert the selection to */
+    xcb_atom_t target;
+    /** The Lua callback */
+    int callback;
+    /** Time to wait for each answer of the owner */
+    double timeout;
+    /** Timeout watcher */
+    struct ev_timer timer;
+    /** True if the owner sends the data in several chunks */
+    bool incr;
+    /** Data received so far */
+    buffer_t data;
+} selection_request_t;
+
+static void
+selection_request_delete(selection_request_t **request)
+{
+    luaA_unregister(globalconf.L, &(*request)->callback);
+    buffer_wipe(&(*request)->data);
+    p_delete(request);
+}
+
+DO_ARRAY(selection_request_t *, selection_request, selection_request_delete)
+
 static xcb_window_t selection_window = XCB_NONE;
+/** Asynchronous requests, the first one is the one being served */
+static selection_request_array_t selection_requests;
 
-/** Get the current X selection buffer.
- * \param L The Lua VM state.
- * \return The number of elements pushed on stack.
- * \luastack
- * \lreturn A string with the current X selection buffer.
+/** Get the window used to receive selections, creating it if needed.
+ * \return The selection window.
  */
-int
-luaA_selection_get(lua_State *L)
+static xcb_window_t
+selection_window_get(void)
 {
     if(selection_window == XCB_NONE)
     {
@@ -51,7 +86,211 @@ luaA_selection_get(lua_State *L)
                           mask, values);
     }
 
-    xcb_convert_selection(globalconf.connection, selection_window,
+    return selection_window;
+}
+
+/** Get an atom by its name, or a default one.
+ * \param L The Lua VM state.
+ * \param idx The name index on the stack.
+ * \param def The atom to use if there is no name.
+ * \return The atom.
+ */
+static xcb_atom_t
+selection_atom_get(lua_State *L, int idx, xcb_atom_t def)
+{
+    size_t len;
+    const char *name = luaL_optlstring(L, idx, NULL, &len);
+    xcb_atom_t atom = def;
+
+    if(name)
+    {
+        xcb_intern_atom_reply_t *reply =
+            xcb_intern_atom_reply(globalconf.connection,
+                                  xcb_intern_atom_unchecked(globalconf.connection,
+                                                            false, len, name),
+                                  NULL);
+        if(reply)
+        {
+            atom = reply->atom;
+            p_delete(&reply);
+        }
+    }
+
+    return atom;
+}
+
+/** Ask the owner of the selection of the first request to send it. */
+static void
+selection_request_send(void)
+{
+    if(!selection_requests.len)
+        return;
+
+    selection_request_t *request = selection_requests.tab[0];
+
+    xcb_convert_selection(globalconf.connection, selection_window_get(),
+                          request->selection, request->target,
+                          _AWESOME_SELECTION, XCB_CURRENT_TIME);
+    ev_timer_start(globalconf.loop, &request->timer);
+}
+
+/** Check if the request being served asks for a selection and target.
+ * \param selection The selection.
+ * \param target The target.
+ * \return True if the owner may be answering such a request.
+ */
+static bool
+selection_request_inflight(xcb_atom_t selection, xcb_atom_t target)
+{
+    return selection_requests.len
+        && selection_requests.tab[0]->selection == selection
+        && selection_requests.tab[0]->target == target;
+}
+
+/** Answer the first request and send the next one.
+ * \param success True if the data has been received.
+ */
+static void
+selection_request_finish(bool success)
+{
+    selection_request_t *request = selection_request_array_take(&selection_requests, 0);
+
+    ev_timer_stop(globalconf.loop, &request->timer);
+
+    /* Send the next request before the callback can queue a new one,
+     * which is sent at once if the queue is empty */
+    selection_request_send();
+
+    if(success)
+        lua_pushlstring(globalconf.L, request->data.s, request->data.len);
+    else
+        lua_pushnil(globalconf.L);
+    luaA_dofunction_from_registry(globalconf.L, request->callback, 1, 0);
+
+    selection_request_delete(&request);
+}
+
+static void
+selection_request_timeout(struct ev_loop *loop, ev_timer *w, int revents)
+{
+    selection_request_finish(false);
+}
+
+/** Handle the answer of a selection owner.
+ * \param data Unused data.
+ * \param connection The connection to the X server.
+ * \param ev The event.
+ * \return Always 0.
+ */
+int
+selection_handle_selectionnotify(void *data __attribute__ ((unused)),
+                                 xcb_connection_t *connection,
+                                 xcb_selection_notify_event_t *ev)
+{
+    if(!selection_requests.len
+       || ev->requestor != selection_window
+       || (ev->property != XCB_NONE && ev->property != _AWESOME_SELECTION))
+        return 0;
+
+    selection_request_t *request = selection_requests.tab[0];
+
+    /* Late answer to a request that timed out */
+    if(ev->selection != request->selection || ev->target != request->target)
+        return 0;
+
+    if(ev->property == XCB_NONE)
+    {
+        selection_request_finish(false);
+        return 0;
+    }
+
+    /* Deleting the property tells an INCR owner to send the first chunk */
+    xcb_get_property_reply_t *reply =
+        xcb_get_property_reply(connection,
+                               xcb_get_property_unchecked(connection, true, ev->requestor,
+                                                          ev->property, XCB_GET_PROPERTY_TYPE_ANY,
+                                                          0, UINT_MAX),
+                               NULL);
+
+    if(!reply)
+        selection_request_finish(false);
+    else if(reply->type == INCR)
+    {
+        request->incr = true;
+        ev_timer_again(globalconf.loop, &request->timer);
+    }
+    else
+    {
+        buffer_add(&request->data, xcb_get_property_value(reply),
+                   xcb_get_property_value_length(reply));
+        selection_request_finish(true);
+    }
+
+    p_delete(&reply);
+
+    return 0;
+}
+
+/** Handle a chunk of an INCR selection transfer.
+ * \param data Unused data.
+ * \param connection The connection to the X server.
+ * \param state The property state.
+ * \param window The window.
+ * \param name The property name.
+ * \param reply Unused, the property is registered without its value.
+ * \return Always 0.
+ */
+int
+selection_handle_property(void *data __attribute__ ((unused)),
+                          xcb_connection_t *connection,
+                          uint8_t state,
+                          xcb_window_t window,
+                          xcb_atom_t name,
+                          xcb_get_property_reply_t *reply __attribute__ ((unused)))
+{
+    if(!selection_requests.len
+       || window != selection_window
+       || state != XCB_PROPERTY_NEW_VALUE
+       || !selection_requests.tab[0]->incr)
+        return 0;
+
+    selection_request_t *request = selection_requests.tab[0];
+
+    /* Deleting the property asks the owner for the next chunk */
+    xcb_get_property_reply_t *chunk =
+        xcb_get_property_reply(connection,
+                               xcb_get_property_unchecked(connection, true, window, name,
+                                                          XCB_GET_PROPERTY_TYPE_ANY,
+                                                          0, UINT_MAX),
+                               NULL);
+
+    if(!chunk)
+        selection_request_finish(false);
+    /* An empty chunk ends the transfer */
+    else if(xcb_get_property_value_length(chunk))
+    {
+        buffer_add(&request->data, xcb_get_property_value(chunk),
+                   xcb_get_property_value_length(chunk));
+        ev_timer_again(globalconf.loop, &request->timer);
+    }
+    else
+        selection_request_finish(true);
+
+    p_delete(&chunk);
+
+    return 0;
+}
+
+/** Get the current X selection buffer.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lreturn A string with the current X selection buffer.
+ */
+static int
+luaA_selection_get(lua_State *L)
+{
+    xcb_convert_selection(globalconf.connection, selection_window_get(),
                           PRIMARY, UTF8_STRING, XSEL_DATA, XCB_CURRENT_TIME);
     xcb_flush(globalconf.connection);
 
@@ -64,27 +303,28 @@ luaA_selection_get(lua_State *L)
         if(!event)
             return 0;
 
-        if(XCB_EVENT_RESPONSE_TYPE(event) != XCB_SELECTION_NOTIFY)
+        xcb_selection_notify_event_t *event_notify =
+            (xcb_selection_notify_event_t *) event;
+
+        /* Let other events, including the answers to asynchronous
+         * requests, go through the usual handlers. A refusal has no
+         * property to tell whose it is: if an asynchronous request for the
+         * same selection was sent before, it is the answer to that one. */
+        if(XCB_EVENT_RESPONSE_TYPE(event) != XCB_SELECTION_NOTIFY
+           || event_notify->requestor != selection_window
+           || event_notify->selection != PRIMARY
+           || event_notify->target != UTF8_STRING
+           || (event_notify->property != XSEL_DATA
+               && (event_notify->property != XCB_NONE
+                   || selection_request_inflight(PRIMARY, UTF8_STRING))))
         {
-            /* \todo Eventually, this may be rewritten with adding a static
-             * buffer, then a event handler for XCB_SELECTION_NOTIFY, then call
-             * xcb_event_poll_for_event_loop() and awesome_refresh(),
-             * then check if some static buffer has been filled with data.
-             * If yes, that'd be the xsel data, otherwise, re-loop.
-             * Anyway that's still brakes the socket or D-Bus, so maybe using
-             * ev_loop() would be even better.
-             */
             xcb_event_handle(&globalconf.evenths, event);
             p_delete(&event);
             awesome_refresh();
             continue;
         }
 
-        xcb_selection_notify_event_t *event_notify =
-            (xcb_selection_notify_event_t *) event;
-
-        if(event_notify->selection == PRIMARY
-           && event_notify->property != XCB_NONE)
+        if(event_notify->property != XCB_NONE)
         {
             xcb_get_text_property_reply_t prop;
             xcb_get_property_cookie_t cookie =
@@ -107,13 +347,57 @@ luaA_selection_get(lua_State *L)
 
                 return 1;
             }
-            else
-                break;
         }
+
+        break;
     }
 
     p_delete(&event);
     return 0;
 }
 
+/** Get the content of a selection without waiting for it.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lparam A function called with the selection content, or nil if it
+ * could not be retrieved.
+ * \lparam An optional selection name, PRIMARY by default.
+ * \lparam An optional target name, UTF8_STRING by default.
+ * \lparam An optional timeout in seconds.
+ */
+static int
+luaA_selection_get_async(lua_State *L)
+{
+    luaA_checkfunction(L, 1);
+
+    selection_request_t *request = p_new(selection_request_t, 1);
+
+    request->callback = LUA_REFNIL;
+    luaA_registerfct(L, 1, &request->callback);
+    request->selection = selection_atom_get(L, 2, PRIMARY);
+    request->target = selection_atom_get(L, 3, UTF8_STRING);
+    request->timeout = luaL_optnumber(L, 4, SELECTION_TIMEOUT);
+    buffer_init(&request->data);
+    ev_timer_init(&request->timer, selection_request_timeout, request->timeout, request->timeout);
+
+    selection_request_array_append(&selection_requests, request);
+
+    if(selection_requests.len == 1)
+        selection_request_send();
+
+    return 0;
+}
+
+const struct luaL_reg awesome_selection_methods[] =
+{
+    { "__call", luaA_selection_get },
+    { "get_async", luaA_selection_get_async },
+    { NULL, NULL }
+};
+const struct luaL_reg awesome_selection_meta[] =
+{
+    { NULL, NULL }
+};
+
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
@@ -22,9 +22,11 @@
 #ifndef AWESOME_SELECTION_H
 #define AWESOME_SELECTION_H
 
-#include <lua.h>
+#include <xcb/xcb.h>
 
-int luaA_selection_get(lua_State *);
+int selection_handle_selectionnotify(void *, xcb_connection_t *, xcb_selection_notify_event_t *);
+int selection_handle_property(void *, xcb_connection_t *, uint8_t, xcb_window_t,
+                              xcb_atom_t, xcb_get_property_reply_t *);
 
 #endif
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
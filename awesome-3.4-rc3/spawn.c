@@ -21,6 +21,7 @@
 
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
@@ -30,6 +31,7 @@
 #include "screen.h"
 #include "luaa.h"
 #include "event.h"
+#include "common/buffer.h"
 
 /** 20 seconds timeout */
 #define AWESOME_SPAWN_TIMEOUT 20.0
@@ -79,6 +81,8 @@ spawn_monitor_timeout(struct ev_loop *loop, ev_timer *w, int revents)
              lua_setfield(globalconf.L, -2, "id");
              foreach(func, sig->sigfuncs)
              {
+                 if(!*func)
+                     continue;
                  lua_pushvalue(globalconf.L, -1);
                  luaA_object_push(globalconf.L, (void *) *func);
                  luaA_dofunction(globalconf.L, 1, 0);
@@ -185,6 +189,8 @@ spawn_monitor_event(SnMonitorEvent *event, void *data)
     {
         foreach(func, sig->sigfuncs)
         {
+            if(!*func)
+                continue;
             lua_pushvalue(globalconf.L, -1);
             luaA_object_push(globalconf.L, (void *) *func);
             luaA_dofunction(globalconf.L, 1, 0);
@@ -374,6 +380,256 @@ luaA_spawn(lua_State *L)
     return 0;
 }
 
+/** An output pipe of an asynchronously spawned process */
+typedef struct
+{
+    /** The pipe watcher */
+    struct ev_io io;
+    /** Data read but not given to Lua yet */
+    buffer_t buffer;
+    /** The Lua function to give the data to */
+    int callback;
+} spawn_output_t;
+
+/** An asynchronously spawned process */
+typedef struct
+{
+    /** The process watcher */
+    struct ev_child child;
+    /** Standard output */
+    spawn_output_t out;
+    /** Standard error */
+    spawn_output_t err;
+    /** The Lua function to call on exit */
+    int exit_callback;
+    /** Give output line by line rather than all at once */
+    bool lines;
+    /** Number of watchers still running */
+    int running;
+} spawn_process_t;
+
+/** Free a process once its watchers are all done.
+ * \param process The process.
+ */
+static void
+spawn_process_unref(spawn_process_t *process)
+{
+    if(--process->running)
+        return;
+
+    luaA_unregister(globalconf.L, &process->out.callback);
+    luaA_unregister(globalconf.L, &process->err.callback);
+    luaA_unregister(globalconf.L, &process->exit_callback);
+    buffer_wipe(&process->out.buffer);
+    buffer_wipe(&process->err.buffer);
+    p_delete(&process);
+}
+
+/** Give some output to Lua.
+ * \param output The output.
+ * \param data The data.
+ * \param len The data length.
+ */
+static void
+spawn_output_emit(spawn_output_t *output, const char *data, int len)
+{
+    lua_pushlstring(globalconf.L, data, len);
+    luaA_dofunction_from_registry(globalconf.L, output->callback, 1, 0);
+}
+
+static void
+spawn_output_read(struct ev_loop *loop, ev_io *w, int revents)
+{
+    spawn_process_t *process = w->data;
+    spawn_output_t *output = w == &process->out.io ? &process->out : &process->err;
+    char buf[BUFSIZ];
+    ssize_t len = read(w->fd, buf, sizeof(buf));
+
+    if(len < 0 && (errno == EAGAIN || errno == EINTR))
+        return;
+
+    if(len > 0)
+    {
+        buffer_add(&output->buffer, buf, len);
+
+        if(process->lines)
+        {
+            char *start = output->buffer.s, *eol;
+            char *end = output->buffer.s + output->buffer.len;
+
+            while((eol = memchr(start, '\n', end - start)))
+            {
+                spawn_output_emit(output, start, eol - start);
+                start = eol + 1;
+            }
+
+            buffer_splice(&output->buffer, 0, start - output->buffer.s, NULL, 0);
+        }
+
+        return;
+    }
+
+    /* End of file: give what's left */
+    if(!process->lines || output->buffer.len)
+        spawn_output_emit(output, output->buffer.s, output->buffer.len);
+
+    ev_io_stop(loop, w);
+    close(w->fd);
+    spawn_process_unref(process);
+}
+
+static void
+spawn_child_exited(struct ev_loop *loop, ev_child *w, int revents)
+{
+    spawn_process_t *process = w->data;
+
+    ev_child_stop(loop, w);
+
+    if(process->exit_callback != LUA_REFNIL)
+    {
+        if(WIFSIGNALED(w->rstatus))
+        {
+            lua_pushliteral(globalconf.L, "signal");
+            lua_pushnumber(globalconf.L, WTERMSIG(w->rstatus));
+        }
+        else
+        {
+            lua_pushliteral(globalconf.L, "exit");
+            lua_pushnumber(globalconf.L, WEXITSTATUS(w->rstatus));
+        }
+        luaA_dofunction_from_registry(globalconf.L, process->exit_callback, 2, 0);
+    }
+
+    spawn_process_unref(process);
+}
+
+/** Start watching an output pipe of a process.
+ * \param process The process.
+ * \param output The output.
+ * \param fd The pipe.
+ */
+static void
+spawn_output_watch(spawn_process_t *process, spawn_output_t *output, int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    buffer_init(&output->buffer);
+    ev_io_init(&output->io, spawn_output_read, fd, EV_READ);
+    output->io.data = process;
+    ev_io_start(globalconf.loop, &output->io);
+    process->running++;
+}
+
+/** Check that an optional field of a table is a function.
+ * \param L The Lua VM state.
+ * \param idx The table index on the stack.
+ * \param name The field name.
+ */
+static void
+spawn_callback_check(lua_State *L, int idx, const char *name)
+{
+    lua_getfield(L, idx, name);
+    if(!lua_isnil(L, -1))
+        luaA_checkfunction(L, -1);
+    lua_pop(L, 1);
+}
+
+/** Register an optional function field of a table.
+ * The field must have been checked with spawn_callback_check().
+ * \param L The Lua VM state.
+ * \param idx The table index on the stack.
+ * \param name The field name.
+ * \return The function reference, or LUA_REFNIL.
+ */
+static int
+spawn_callback_get(lua_State *L, int idx, const char *name)
+{
+    int ref = LUA_REFNIL;
+
+    lua_getfield(L, idx, name);
+    if(!lua_isnil(L, -1))
+        luaA_register(L, -1, &ref);
+    lua_pop(L, 1);
+
+    return ref;
+}
+
+/** Spawn a program without waiting for it, and give its output and exit
+ * status to Lua functions.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack
+ * \luastack
+ * \lparam The command to launch.
+ * \lparam A table with optional stdout, stderr and exit functions, and a
+ * lines boolean to get the output line by line rather than all at once.
+ * \lreturn The process id, or nil and an error string.
+ */
+int
+luaA_spawn_async(lua_State *L)
+{
+    const char *cmd = luaL_checkstring(L, 1);
+    gchar **argv = NULL;
+    GError *error = NULL;
+    GPid pid;
+    gint out_fd = -1, err_fd = -1;
+
+    /* the options are always a table at index 2 */
+    lua_settop(L, 2);
+    if(lua_isnil(L, 2))
+    {
+        lua_createtable(L, 0, 0);
+        lua_replace(L, 2);
+    }
+    else
+        luaA_checktable(L, 2);
+
+    /* Raise errors before anything is allocated or registered */
+    spawn_callback_check(L, 2, "stdout");
+    spawn_callback_check(L, 2, "stderr");
+    spawn_callback_check(L, 2, "exit");
+
+    spawn_process_t *process = p_new(spawn_process_t, 1);
+
+    process->out.callback = spawn_callback_get(L, 2, "stdout");
+    process->err.callback = spawn_callback_get(L, 2, "stderr");
+    process->exit_callback = spawn_callback_get(L, 2, "exit");
+    lua_getfield(L, 2, "lines");
+    process->lines = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+
+    if(!g_shell_parse_argv(cmd, NULL, &argv, &error)
+       || !g_spawn_async_with_pipes(NULL, argv, NULL,
+                                    G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD,
+                                    spawn_child_callback, NULL, &pid, NULL,
+                                    process->out.callback != LUA_REFNIL ? &out_fd : NULL,
+                                    process->err.callback != LUA_REFNIL ? &err_fd : NULL,
+                                    &error))
+    {
+        g_strfreev(argv);
+        process->running = 1;
+        spawn_process_unref(process);
+        lua_pushnil(L);
+        lua_pushstring(L, error->message);
+        g_error_free(error);
+        return 2;
+    }
+
+    g_strfreev(argv);
+
+    ev_child_init(&process->child, spawn_child_exited, pid, 0);
+    process->child.data = process;
+    ev_child_start(globalconf.loop, &process->child);
+    process->running++;
+
+    if(out_fd >= 0)
+        spawn_output_watch(process, &process->out, out_fd);
+    if(err_fd >= 0)
+        spawn_output_watch(process, &process->err, err_fd);
+
+    lua_pushnumber(L, pid);
+    return 1;
+}
+
 /** Spawn a program. This works exactly as system() does, but clears the signal mask.
  * \param arg The shell command to execute.
  * \return The return status of the program.
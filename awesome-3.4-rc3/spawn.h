@@ -27,6 +27,7 @@
 void spawn_init(void);
 void spawn_start_notify(client_t *, const char *);
 int luaA_spawn(lua_State *);
+int luaA_spawn_async(lua_State *);
 
 int spawn_system(const char *);
 
@@ -38,11 +38,34 @@ struct tag
     bool selected;
     /** clients in this tag */
     client_array_t clients;
+    /** Bit of the tag in the tag masks, 0 until it needs one */
+    unsigned int id;
 };
 
 static lua_class_t tag_class;
 LUA_OBJECT_FUNCS(tag_class, tag_t, tag)
 
+/** Bits used by tags in the tag masks */
+static tag_mask_t tag_ids;
+
+/** Get the bit of a tag in the tag masks, giving it a free one on first use.
+ * \param tag The tag.
+ * \return The tag id.
+ */
+static unsigned int
+tag_id(tag_t *tag)
+{
+    if(!tag->id)
+    {
+        unsigned int id = 1;
+        while(tag_mask_isset(&tag_ids, id))
+            id++;
+        tag_mask_set(&tag_ids, id);
+        tag->id = id;
+    }
+
+    return tag->id;
+}
 
 void
 tag_unref_simplified(tag_t **tag)
@@ -60,6 +83,9 @@ luaA_tag_gc(lua_State *L)
     tag_t *tag = luaA_checkudata(L, 1, &tag_class);
     client_array_wipe(&tag->clients);
     p_delete(&tag->name);
+    /* Neither a client nor a screen can hold the id of a collected tag */
+    if(tag->id)
+        tag_mask_unset(&tag_ids, tag->id);
     return luaA_object_gc(L);
 }
 
@@ -83,6 +109,11 @@ tag_view(lua_State *L, int udx, bool view)
         {
             int screen_index = screen_array_indexof(&globalconf.screens, tag->screen);
 
+            if(view)
+                tag_mask_set(&tag->screen->selected_tags, tag_id(tag));
+            else
+                tag_mask_unset(&tag->screen->selected_tags, tag->id);
+
             banning_need_update(tag->screen);
 
             ewmh_update_net_current_desktop(screen_virttophys(screen_index));
@@ -125,6 +156,8 @@ tag_append_to_screen(lua_State *L, int udx, screen_t *s)
 
     tag->screen = s;
     tag_array_append(&s->tags, luaA_object_ref_class(globalconf.L, udx, &tag_class));
+    if(tag->selected)
+        tag_mask_set(&s->selected_tags, tag_id(tag));
     ewmh_update_net_numbers_of_desktop(phys_screen);
     ewmh_update_net_desktop_names(phys_screen);
     ewmh_update_workarea(phys_screen);
@@ -168,7 +201,10 @@ tag_remove_from_screen(tag_t *tag)
 
     /* tag was selected? If so, reban */
     if(tag->selected)
+    {
+        tag_mask_unset(&tag->screen->selected_tags, tag->id);
         banning_need_update(tag->screen);
+    }
 
     ewmh_update_net_numbers_of_desktop(phys_screen);
     ewmh_update_net_desktop_names(phys_screen);
@@ -225,6 +261,7 @@ tag_client(client_t *c)
     }
 
     client_array_append(&t->clients, c);
+    tag_mask_set(&c->tags, tag_id(t));
     ewmh_client_update_desktop(c);
     banning_need_update((c)->screen);
 
@@ -245,10 +282,14 @@ tag_client(client_t *c)
 void
 untag_client(client_t *c, tag_t *t)
 {
+    if(!is_client_tagged(c, t))
+        return;
+
     for(int i = 0; i < t->clients.len; i++)
         if(t->clients.tab[i] == c)
         {
             client_array_take(&t->clients, i);
+            tag_mask_unset(&c->tags, t->id);
             banning_need_update((c)->screen);
             ewmh_client_update_desktop(c);
             /* call hook */
@@ -272,11 +313,7 @@ untag_client(client_t *c, tag_t *t)
 bool
 is_client_tagged(client_t *c, tag_t *t)
 {
-    for(int i = 0; i < t->clients.len; i++)
-        if(t->clients.tab[i] == c)
-            return true;
-
-    return false;
+    return tag_mask_isset(&c->tags, t->id);
 }
 
 /** Get the index of the first selected tag.
@@ -0,0 +1,111 @@
+/*
+ * tagmask.h - tag set header
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AWESOME_TAGMASK_H
+#define AWESOME_TAGMASK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "common/util.h"
+
+#define TAG_MASK_BITS 32
+
+/** A set of tags, one bit per tag id */
+typedef struct
+{
+    uint32_t *bits;
+    /** Number of words in bits */
+    int len;
+} tag_mask_t;
+
+/** Add a tag id to a tag set.
+ * \param mask The tag set.
+ * \param id The tag id.
+ */
+static inline void
+tag_mask_set(tag_mask_t *mask, unsigned int id)
+{
+    int word = id / TAG_MASK_BITS;
+
+    if(word >= mask->len)
+    {
+        p_realloc(&mask->bits, word + 1);
+        p_clear(mask->bits + mask->len, word + 1 - mask->len);
+        mask->len = word + 1;
+    }
+
+    mask->bits[word] |= 1U << (id % TAG_MASK_BITS);
+}
+
+/** Remove a tag id from a tag set.
+ * \param mask The tag set.
+ * \param id The tag id.
+ */
+static inline void
+tag_mask_unset(tag_mask_t *mask, unsigned int id)
+{
+    int word = id / TAG_MASK_BITS;
+
+    if(word < mask->len)
+        mask->bits[word] &= ~(1U << (id % TAG_MASK_BITS));
+}
+
+/** Check if a tag set contains a tag id.
+ * \param mask The tag set.
+ * \param id The tag id.
+ * \return True if the tag id is in the set.
+ */
+static inline bool
+tag_mask_isset(const tag_mask_t *mask, unsigned int id)
+{
+    int word = id / TAG_MASK_BITS;
+
+    return word < mask->len && (mask->bits[word] & (1U << (id % TAG_MASK_BITS)));
+}
+
+/** Check if two tag sets have a tag in common.
+ * \param a A tag set.
+ * \param b Another tag set.
+ * \return True if a tag id is in both sets.
+ */
+static inline bool
+tag_mask_intersects(const tag_mask_t *a, const tag_mask_t *b)
+{
+    for(int i = 0; i < a->len && i < b->len; i++)
+        if(a->bits[i] & b->bits[i])
+            return true;
+
+    return false;
+}
+
+/** Wipe a tag set.
+ * \param mask The tag set.
+ */
+static inline void
+tag_mask_wipe(tag_mask_t *mask)
+{
+    p_delete(&mask->bits);
+    mask->len = 0;
+}
+
+#endif
+// vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
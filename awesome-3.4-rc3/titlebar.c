@@ -49,9 +49,10 @@ client_getbytitlebar(wibox_t *titlebar)
 client_t *
 client_getbytitlebarwin(xcb_window_t win)
 {
-    foreach(c, globalconf.clients)
-        if((*c)->titlebar && (*c)->titlebar->window == win)
-            return *c;
+    window_owner_t *owner = window_owner_getbywin(win);
+
+    if(owner && owner->wibox)
+        return owner->client;
 
     return NULL;
 }
@@ -262,6 +263,9 @@ titlebar_client_attach(client_t *c)
 
     wibox_init(t, c->phys_screen);
 
+    /* Let the titlebar window lead to its client. */
+    window_owner_register(t->window, c, t);
+
     t->need_update = true;
 
     /* Call update geometry. This will move the wibox to the right place,
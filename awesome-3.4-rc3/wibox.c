@@ -20,6 +20,7 @@
  */
 
 #include <xcb/shape.h>
+#include <xcb/randr.h>
 
 #include "screen.h"
 #include "wibox.h"
@@ -34,6 +35,111 @@
 
 LUA_OBJECT_FUNCS(wibox_class, wibox_t, wibox)
 
+/** Get the wiboxes containing a widget or a widgets table.
+ * \param item The item, as returned by lua_topointer().
+ * \return The index entry of the item, or NULL if no wibox contains it.
+ */
+wibox_item_t *
+wibox_item_getbyitem(const void *item)
+{
+    wibox_item_t witem = { .item = item };
+    return wibox_item_array_lookup(&globalconf.wibox_items, &witem);
+}
+
+/** Remove a wibox from the items index.
+ * \param wibox The wibox.
+ */
+static void
+wibox_items_remove(wibox_t *wibox)
+{
+    foreach(item, wibox->items)
+    {
+        wibox_item_t *witem = wibox_item_getbyitem(*item);
+        if(witem)
+        {
+            foreach(w, witem->wiboxes)
+                if(*w == wibox)
+                {
+                    cptr_array_remove(&witem->wiboxes, w);
+                    break;
+                }
+            if(!witem->wiboxes.len)
+            {
+                wibox_item_wipe(witem);
+                wibox_item_array_remove(&globalconf.wibox_items, witem);
+            }
+        }
+    }
+    cptr_array_wipe(&wibox->items);
+}
+
+/** Record that a wibox contains an item.
+ * \param wibox The wibox.
+ * \param item The item, as returned by lua_topointer().
+ */
+static void
+wibox_items_add(wibox_t *wibox, const void *item)
+{
+    wibox_item_t *witem = wibox_item_getbyitem(item);
+
+    if(witem)
+    {
+        foreach(w, witem->wiboxes)
+            if(*w == wibox)
+                return;
+        cptr_array_append(&witem->wiboxes, wibox);
+    }
+    else
+    {
+        wibox_item_t new_witem = { .item = item };
+        cptr_array_append(&new_witem.wiboxes, wibox);
+        wibox_item_array_insert(&globalconf.wibox_items, new_witem);
+    }
+
+    cptr_array_append(&wibox->items, item);
+}
+
+/** Record a table on top of the stack and everything it contains as
+ * being part of a wibox.
+ * \param L The Lua VM state.
+ * \param wibox The wibox.
+ */
+static void
+wibox_items_add_table(lua_State *L, wibox_t *wibox)
+{
+    wibox_items_add(wibox, lua_topointer(L, -1));
+
+    lua_pushnil(L);
+    while(luaA_next(L, -2))
+    {
+        if(lua_istable(L, -1))
+            wibox_items_add_table(L, wibox);
+        else if(luaA_toudata(L, -1, &widget_class))
+            wibox_items_add(wibox, lua_topointer(L, -1));
+        /* remove value */
+        lua_pop(L, 1);
+    }
+}
+
+/** Rebuild the items index of a wibox from its widgets table.
+ * \param L The Lua VM state.
+ * \param wibox The wibox.
+ */
+static void
+wibox_items_update(lua_State *L, wibox_t *wibox)
+{
+    wibox_items_remove(wibox);
+
+    if(wibox->widgets_table)
+    {
+        luaA_object_push(L, wibox);
+        luaA_object_push_item(L, -1, wibox->widgets_table);
+        lua_remove(L, -2);
+        wibox_items_add_table(L, wibox);
+        lua_pop(L, 1);
+    }
+}
+
 /** Take care of garbage collecting a wibox.
  * \param L The Lua VM state.
  * \return The number of elements pushed on stack, 0!
@@ -44,6 +150,7 @@ luaA_wibox_gc(lua_State *L)
     wibox_t *wibox = luaA_checkudata(L, 1, &wibox_class);
     p_delete(&wibox->cursor);
     wibox_wipe(wibox);
+    wibox_items_remove(wibox);
     button_array_wipe(&wibox->buttons);
     widget_node_array_wipe(&wibox->widgets);
     return luaA_object_gc(L);
@@ -81,7 +188,22 @@ shape_update(xcb_window_t win, xcb_shape_kind_t kind, image_t *image, int offset
     xcb_pixmap_t shape;
 
     if(image)
+    {
+        int len;
+        xcb_rectangle_t *rects = image_getshape(image, &len);
+
+        /* Shapes too complex to fit in a request are sent as a mask */
+        if(sizeof(xcb_shape_rectangles_request_t) + len * sizeof(xcb_rectangle_t)
+           <= xcb_get_maximum_request_length(globalconf.connection) * 4)
+        {
+            xcb_shape_rectangles(globalconf.connection, XCB_SHAPE_SO_SET, kind,
+                                 XCB_CLIP_ORDERING_YX_BANDED, win, offset, offset,
+                                 len, rects);
+            return;
+        }
+
         shape = image_to_1bit_pixmap(image, win);
+    }
     else
         /* Reset the shape */
         shape = XCB_NONE;
@@ -126,27 +248,22 @@ wibox_draw_context_update(wibox_t *w, xcb_screen_t *s)
 
     draw_context_wipe(&w->ctx);
 
-    /* update draw context */
+    /* update draw context, which draws rotated straight into the pixmap */
     switch(w->orientation)
     {
       case South:
       case North:
-        /* we need a new pixmap this way [     ] to render */
-        w->ctx.pixmap = xcb_generate_id(globalconf.connection);
-        xcb_create_pixmap(globalconf.connection,
-                          s->root_depth,
-                          w->ctx.pixmap, s->root,
-                          w->geometry.height,
-                          w->geometry.width);
         draw_context_init(&w->ctx, phys_screen,
                           w->geometry.height,
                           w->geometry.width,
-                          w->ctx.pixmap, &fg, &bg);
+                          w->orientation,
+                          w->pixmap, &fg, &bg);
         break;
       case East:
         draw_context_init(&w->ctx, phys_screen,
                           w->geometry.width,
                           w->geometry.height,
+                          w->orientation,
                           w->pixmap, &fg, &bg);
         break;
     }
@@ -181,6 +298,8 @@ wibox_init(wibox_t *w, int phys_screen)
                           | XCB_EVENT_MASK_PROPERTY_CHANGE
                       });
 
+    window_owner_register(w->window, NULL, w);
+
     /* Create a pixmap. */
     w->pixmap = xcb_generate_id(globalconf.connection);
     xcb_create_pixmap(globalconf.connection, s->root_depth, w->pixmap, s->root,
@@ -248,9 +367,6 @@ wibox_moveresize(lua_State *L, int udx, area_t geometry)
         if(mask_vals & (XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT))
         {
             xcb_free_pixmap(globalconf.connection, w->pixmap);
-            /* orientation != East */
-            if(w->pixmap != w->ctx.pixmap)
-                xcb_free_pixmap(globalconf.connection, w->ctx.pixmap);
             w->pixmap = xcb_generate_id(globalconf.connection);
             xcb_screen_t *s = xutil_screen_get(globalconf.connection, w->ctx.phys_screen);
             xcb_create_pixmap(globalconf.connection, s->root_depth, w->pixmap, s->root,
@@ -354,9 +470,6 @@ wibox_set_orientation(lua_State *L, int udx, orientation_t o)
     {
         xcb_screen_t *s = xutil_screen_get(globalconf.connection, w->ctx.phys_screen);
         w->orientation = o;
-        /* orientation != East */
-        if(w->pixmap != w->ctx.pixmap)
-            xcb_free_pixmap(globalconf.connection, w->ctx.pixmap);
         wibox_draw_context_update(w, s);
         luaA_object_emit_signal(L, udx, "property::orientation", 0);
     }
@@ -565,16 +678,10 @@ wibox_systray_refresh(wibox_t *wibox)
 wibox_t *
 wibox_getbywin(xcb_window_t win)
 {
-    foreach(w, globalconf.wiboxes)
-        if((*w)->window == win)
-            return *w;
+    window_owner_t *owner = window_owner_getbywin(win);
 
-    foreach(_c, globalconf.clients)
-    {
-        client_t *c = *_c;
-        if(c->titlebar && c->titlebar->window == win)
-            return c->titlebar;
-    }
+    if(owner)
+        return owner->wibox;
 
     return NULL;
 }
@@ -587,33 +694,161 @@ wibox_draw(wibox_t *wibox)
 {
     if(wibox->visible)
     {
-        widget_render(wibox);
-        wibox_refresh_pixmap(wibox);
+        area_t dirty;
+
+        if(!wibox->need_update && widget_render_partial(wibox, &dirty))
+        {
+            if(dirty.width && dirty.height)
+                wibox_refresh_pixmap_partial(wibox, dirty.x, dirty.y, dirty.width, dirty.height);
+        }
+        else
+        {
+            widget_render(wibox);
+            wibox_refresh_pixmap(wibox);
+        }
 
         wibox->need_update = false;
+        wibox->need_widget_update = false;
     }
 
     wibox_systray_refresh(wibox);
 }
 
+/** Get the refresh rate of a physical screen.
+ * The rates are asked to RandR once, a screen change restarts awesome anyway.
+ * \param phys_screen The physical screen number.
+ * \return The refresh rate in Hz, or 0 if unknown.
+ */
+static uint16_t
+wibox_refresh_rate(int phys_screen)
+{
+    static uint16_t *rates = NULL;
+
+    if(!rates)
+    {
+        const xcb_query_extension_reply_t *randr_query;
+        int nscreens = xcb_setup_roots_length(xcb_get_setup(globalconf.connection));
+        xcb_randr_get_screen_info_cookie_t cookies[nscreens];
+
+        rates = p_new(uint16_t, nscreens);
+
+        randr_query = xcb_get_extension_data(globalconf.connection, &xcb_randr_id);
+        if(!randr_query->present)
+            return 0;
+
+        for(int screen = 0; screen < nscreens; screen++)
+            cookies[screen] =
+                xcb_randr_get_screen_info_unchecked(globalconf.connection,
+                                                    xutil_screen_get(globalconf.connection, screen)->root);
+
+        for(int screen = 0; screen < nscreens; screen++)
+        {
+            xcb_randr_get_screen_info_reply_t *reply =
+                xcb_randr_get_screen_info_reply(globalconf.connection, cookies[screen], NULL);
+
+            if(reply)
+            {
+                rates[screen] = reply->rate;
+                p_delete(&reply);
+            }
+        }
+    }
+
+    return rates[phys_screen];
+}
+
+/** Get the minimum time between two redraws of a wibox.
+ * \param wibox The wibox.
+ * \return The interval in seconds.
+ */
+static ev_tstamp
+wibox_frame_interval(wibox_t *wibox)
+{
+    ev_tstamp interval = wibox->fps > 0 ? 1 / wibox->fps : 0;
+
+    if(wibox->vsync)
+    {
+        uint16_t rate = wibox_refresh_rate(wibox->ctx.phys_screen);
+
+        /* At least one refresh period, and a whole number of them */
+        if(rate)
+            interval = MAX(1, (int) (interval * rate + 0.999)) / (ev_tstamp) rate;
+    }
+
+    return interval;
+}
+
+/** Draw a wibox, unless it has been drawn less than a frame ago.
+ * A deferred wibox keeps its update flags, so every change made until its
+ * deadline ends up in the same redraw.
+ * \param wibox The wibox to draw.
+ * \param now The current loop time.
+ * \param next The earliest deadline of the deferred wiboxes, 0 if none.
+ */
+static void
+wibox_draw_scheduled(wibox_t *wibox, ev_tstamp now, ev_tstamp *next)
+{
+    ev_tstamp deadline;
+
+    /* Nothing is drawn, only the systray is refreshed */
+    if(!wibox->visible)
+    {
+        wibox_draw(wibox);
+        return;
+    }
+
+    deadline = wibox->last_draw + wibox_frame_interval(wibox);
+    wibox->redraws.requested++;
+
+    if(now < deadline)
+    {
+        if(!*next || deadline < *next)
+            *next = deadline;
+        return;
+    }
+
+    wibox->last_draw = now;
+    wibox->redraws.performed++;
+    wibox_draw(wibox);
+}
+
+/** Called when deferred wibox redraws are due.
+ * There is nothing to do here: waking up the loop is enough, since
+ * wibox_refresh() runs before it blocks again.
+ */
+void
+wibox_redraw_timeout(EV_P_ ev_timer *w, int revents)
+{
+}
+
 /** Refresh all wiboxes.
  */
 void
 wibox_refresh(void)
 {
+    ev_tstamp now = ev_now(globalconf.loop), next = 0;
+
     foreach(w, globalconf.wiboxes)
     {
         if((*w)->need_shape_update)
             wibox_shape_update(*w);
-        if((*w)->need_update)
-            wibox_draw(*w);
+        if((*w)->need_update || (*w)->need_widget_update)
+            wibox_draw_scheduled(*w, now, &next);
     }
 
     foreach(_c, globalconf.clients)
     {
         client_t *c = *_c;
-        if(c->titlebar && c->titlebar->need_update)
-            wibox_draw(c->titlebar);
+        if(c->titlebar
+           && (c->titlebar->need_update || c->titlebar->need_widget_update))
+            wibox_draw_scheduled(c->titlebar, now, &next);
+    }
+
+    ev_timer_stop(globalconf.loop, &globalconf.redraw_timer);
+    if(next)
+    {
+        ev_timer_set(&globalconf.redraw_timer, next - now, 0.);
+        ev_timer_start(globalconf.loop, &globalconf.redraw_timer);
     }
 }
 
@@ -668,6 +903,7 @@ wibox_wipe(wibox_t *w)
         xcb_destroy_window(globalconf.connection, w->window);
         /* Deactivate BMA */
         client_restore_enterleave_events();
+        window_owner_unregister(w->window);
         w->window = XCB_NONE;
     }
     if(w->pixmap)
@@ -821,25 +1057,6 @@ luaA_wibox_new(lua_State *L)
     return 1;
 }
 
-/** Check if a wibox widget table has an item.
- * \param L The Lua VM state.
- * \param wibox The wibox.
- * \param item The item to look for.
- */
-static bool
-luaA_wibox_hasitem(lua_State *L, wibox_t *wibox, const void *item)
-{
-    if(wibox->widgets_table)
-    {
-        luaA_object_push(L, wibox);
-        luaA_object_push_item(L, -1, wibox->widgets_table);
-        lua_remove(L, -2);
-        if(lua_topointer(L, -1) == item || luaA_hasitem(L, item))
-            return true;
-    }
-    return false;
-}
-
 /** Invalidate a wibox by a Lua object (table, etc).
  * \param L The Lua VM state.
  * \param item The object identifier.
@@ -847,27 +1064,25 @@ luaA_wibox_hasitem(lua_State *L, wibox_t *wibox, const void *item)
 void
 luaA_wibox_invalidate_byitem(lua_State *L, const void *item)
 {
-    foreach(w, globalconf.wiboxes)
+    wibox_item_t *witem = wibox_item_getbyitem(item);
+
+    if(witem)
     {
-        wibox_t *wibox = *w;
-        if(luaA_wibox_hasitem(L, wibox, item))
+        /* updating the index moves entries around, so work on a copy */
+        cptr_array_t wiboxes;
+        cptr_array_init(&wiboxes);
+        foreach(w, witem->wiboxes)
+            cptr_array_append(&wiboxes, *w);
+
+        foreach(w, wiboxes)
         {
-            /* update wibox */
+            wibox_t *wibox = (wibox_t *) *w;
             wibox_need_update(wibox);
-            lua_pop(L, 1); /* remove widgets table */
+            /* the content of the table changed */
+            wibox_items_update(L, wibox);
         }
 
-    }
-
-    foreach(_c, globalconf.clients)
-    {
-        client_t *c = *_c;
-        if(c->titlebar && luaA_wibox_hasitem(L, c->titlebar, item))
-        {
-            /* update wibox */
-            wibox_need_update(c->titlebar);
-            lua_pop(L, 1); /* remove widgets table */
-        }
+        cptr_array_wipe(&wiboxes);
     }
 }
 
@@ -934,6 +1149,23 @@ LUA_OBJECT_EXPORT_PROPERTY(wibox, wibox_t, cursor, lua_pushstring)
 LUA_OBJECT_EXPORT_PROPERTY(wibox, wibox_t, visible, lua_pushboolean)
 LUA_OBJECT_EXPORT_PROPERTY(wibox, wibox_t, border_width, lua_pushnumber)
 LUA_OBJECT_EXPORT_PROPERTY(wibox, wibox_t, border_color, luaA_pushxcolor)
+LUA_OBJECT_EXPORT_PROPERTY(wibox, wibox_t, fps, lua_pushnumber)
+LUA_OBJECT_EXPORT_PROPERTY(wibox, wibox_t, vsync, lua_pushboolean)
+
+/** Get the wibox redraw statistics.
+ * \param L The Lua VM state.
+ * \return The number of elements pushed on stack.
+ * \luastack
+ * \lreturn The number of redraws requested and the number performed.
+ */
+static int
+luaA_wibox_redraws(lua_State *L)
+{
+    wibox_t *w = luaA_checkudata(L, 1, &wibox_class);
+    lua_pushnumber(L, w->redraws.requested);
+    lua_pushnumber(L, w->redraws.performed);
+    return 2;
+}
 
 static int
 luaA_wibox_set_x(lua_State *L, wibox_t *wibox)
@@ -1108,6 +1340,40 @@ luaA_wibox_set_ontop(lua_State *L, wibox_t *wibox)
     return 0;
 }
 
+/** Set the wibox maximum number of redraws per second.
+ * \param L The Lua VM state.
+ * \param wibox The wibox object.
+ * \return The number of elements pushed on stack.
+ */
+static int
+luaA_wibox_set_fps(lua_State *L, wibox_t *wibox)
+{
+    double fps = luaL_checknumber(L, -1);
+    if(fps >= 0 && fps != wibox->fps)
+    {
+        wibox->fps = fps;
+        luaA_object_emit_signal(L, -3, "property::fps", 0);
+    }
+    return 0;
+}
+
+/** Set whether the wibox redraws are aligned to the screen refresh rate.
+ * \param L The Lua VM state.
+ * \param wibox The wibox object.
+ * \return The number of elements pushed on stack.
+ */
+static int
+luaA_wibox_set_vsync(lua_State *L, wibox_t *wibox)
+{
+    bool b = luaA_checkboolean(L, -1);
+    if(b != wibox->vsync)
+    {
+        wibox->vsync = b;
+        luaA_object_emit_signal(L, -3, "property::vsync", 0);
+    }
+    return 0;
+}
+
 /** Set the wibox opacity.
  * \param L The Lua VM state.
  * \param wibox The wibox object.
@@ -1405,6 +1671,8 @@ luaA_wibox_set_widgets(lua_State *L, wibox_t *wibox)
     luaA_object_emit_signal(L, -3, "property::widgets", 0);
     wibox_need_update(wibox);
     luaA_table2wtable(L);
+    wibox_items_remove(wibox);
+    wibox_items_add_table(L, wibox);
     return 0;
 }
 
@@ -1513,6 +1781,7 @@ wibox_class_setup(lua_State *L)
         { "struts", luaA_wibox_struts },
         { "buttons", luaA_wibox_buttons },
         { "geometry", luaA_wibox_geometry },
+        { "redraws", luaA_wibox_redraws },
         { "__gc", luaA_wibox_gc },
         { NULL, NULL },
     };
@@ -1528,6 +1797,14 @@ wibox_class_setup(lua_State *L)
                             (lua_class_propfunc_t) luaA_wibox_set_opacity,
                             (lua_class_propfunc_t) luaA_wibox_get_opacity,
                             (lua_class_propfunc_t) luaA_wibox_set_opacity);
+    luaA_class_add_property(&wibox_class, A_TK_FPS,
+                            (lua_class_propfunc_t) luaA_wibox_set_fps,
+                            (lua_class_propfunc_t) luaA_wibox_get_fps,
+                            (lua_class_propfunc_t) luaA_wibox_set_fps);
+    luaA_class_add_property(&wibox_class, A_TK_VSYNC,
+                            (lua_class_propfunc_t) luaA_wibox_set_vsync,
+                            (lua_class_propfunc_t) luaA_wibox_get_vsync,
+                            (lua_class_propfunc_t) luaA_wibox_set_vsync);
     luaA_class_add_property(&wibox_class, A_TK_VISIBLE,
                             (lua_class_propfunc_t) luaA_wibox_set_visible,
                             (lua_class_propfunc_t) luaA_wibox_get_visible,
@@ -52,10 +52,14 @@ struct wibox_t
     /** Widget list */
     widget_node_array_t widgets;
     void *widgets_table;
+    /** Widgets and tables indexed as contained in this wibox */
+    cptr_array_t items;
     /** Widget the mouse is over */
     widget_t *mouse_over;
     /** Need update */
     bool need_update;
+    /** Need to redraw some of its widgets only */
+    bool need_widget_update;
     /** Need shape update */
     bool need_shape_update;
     /** Cursor */
@@ -94,6 +98,20 @@ struct wibox_t
         /** The window's content and border */
         image_t *bounding;
     } shape;
+    /** Maximum number of redraws per second, 0 for no limit */
+    double fps;
+    /** Round the redraw interval to whole refresh periods of the screen */
+    bool vsync;
+    /** Loop time of the last redraw */
+    double last_draw;
+    /** Redraw statistics */
+    struct
+    {
+        /** Refreshes that found the wibox needing a redraw */
+        unsigned int requested;
+        /** Redraws actually done */
+        unsigned int performed;
+    } redraws;
 };
 
 void wibox_unref_simplified(wibox_t **);
@@ -101,10 +119,12 @@ void wibox_unref_simplified(wibox_t **);
 ARRAY_FUNCS(wibox_t *, wibox, wibox_unref_simplified)
 
 void wibox_refresh(void);
+void wibox_redraw_timeout(EV_P_ ev_timer *, int);
 
 void luaA_wibox_invalidate_byitem(lua_State *, const void *);
 
 wibox_t * wibox_getbywin(xcb_window_t);
+wibox_item_t * wibox_item_getbyitem(const void *);
 
 void wibox_moveresize(lua_State *, int, area_t);
 void wibox_refresh_pixmap_partial(wibox_t *, int16_t, int16_t, uint16_t, uint16_t);
@@ -58,6 +58,22 @@ widget_node_delete(widget_node_t *node)
     luaA_object_unref(globalconf.L, node->widget);
 }
 
+/** Number of full renders done so far. */
+static unsigned int widget_render_count;
+
+/** Get the extents of a widget, and remember them for the current render.
+ * \param L The Lua VM state.
+ * \param widget The widget, with an extents function.
+ * eturn The widget extents.
+ */
+static area_t
+widget_extents_get(lua_State *L, widget_t *widget)
+{
+    widget->last_extents = widget->extents(L, widget);
+    widget->last_render = widget_render_count;
+    return widget->last_extents;
+}
+
 /** Get a widget node from a wibox by coords.
  * \param orientation Wibox orientation.
  * \param widgets The widget list.
@@ -215,7 +231,7 @@ widget_geometries(wibox_t *wibox)
             lua_pushnumber(globalconf.L, i + 1);
             widget_t *widget = widgets->tab[i].widget;
             lua_pushnumber(globalconf.L, screen_array_indexof(&globalconf.screens, wibox->screen));
-            area_t geometry = widget->extents(globalconf.L, widget);
+            area_t geometry = widget_extents_get(globalconf.L, widget);
             lua_pop(globalconf.L, 1);
             geometry.x = geometry.y = 0;
             geometry.width = MIN(wibox->geometry.width, geometry.width);
@@ -229,6 +245,114 @@ widget_geometries(wibox_t *wibox)
     return true;
 }
 
+/** Get the extents a widget node asks for.
+ * An invisible widget takes no room.
+ * \param wibox The wibox the node belongs to.
+ * \param node The widget node.
+ * \param laid True to reuse the extents the layout of the current render
+ * asked for, if any.
+ * \return The widget extents.
+ */
+static area_t
+widget_node_extents(wibox_t *wibox, widget_node_t *node, bool laid)
+{
+    area_t extents = { 0, 0, 0, 0 };
+    widget_t *widget = node->widget;
+
+    if(!widget->isvisible || !widget->extents)
+        return extents;
+
+    if(laid && widget->last_render == widget_render_count)
+        return widget->last_extents;
+
+    lua_pushnumber(globalconf.L, screen_array_indexof(&globalconf.screens, wibox->screen));
+    extents = widget_extents_get(globalconf.L, widget);
+    lua_pop(globalconf.L, 1);
+
+    return extents;
+}
+
+/** The root window background of a physical screen. */
+typedef struct
+{
+    /** The pixmap set by the wallpaper setter, or XCB_NONE */
+    xcb_pixmap_t pixmap;
+    /** True if pixmap is known, false if it has to be read */
+    bool isvalid;
+} widget_rootpixmap_t;
+
+/** The root window backgrounds, per physical screen. */
+static widget_rootpixmap_t *widget_rootpixmaps;
+
+/** Get the root window background state of a screen.
+ * \param phys_screen The physical screen number.
+ * \return The state.
+ */
+static widget_rootpixmap_t *
+widget_rootpixmap_state(int phys_screen)
+{
+    if(!widget_rootpixmaps)
+        widget_rootpixmaps = p_new(widget_rootpixmap_t,
+                                   xcb_setup_roots_length(xcb_get_setup(globalconf.connection)));
+
+    return &widget_rootpixmaps[phys_screen];
+}
+
+/** Get the pixmap of a _XROOTPMAP_ID property.
+ * \param reply The property reply.
+ * \return The pixmap, or XCB_NONE.
+ */
+static xcb_pixmap_t
+widget_rootpixmap_from_reply(xcb_get_property_reply_t *reply)
+{
+    char *data;
+
+    if(reply && reply->value_len
+       && (data = xcb_get_property_value(reply)))
+        return *(xcb_pixmap_t *) data;
+
+    return XCB_NONE;
+}
+
+/** Update the root window background after _XROOTPMAP_ID changed.
+ * \param phys_screen The physical screen number.
+ * \param reply The new property, or NULL to read it when needed.
+ */
+void
+widget_rootpixmap_update(int phys_screen, xcb_get_property_reply_t *reply)
+{
+    widget_rootpixmap_t *root = widget_rootpixmap_state(phys_screen);
+
+    root->pixmap = widget_rootpixmap_from_reply(reply);
+    root->isvalid = reply != NULL;
+}
+
+/** Get the root window background pixmap.
+ * \param phys_screen The physical screen number.
+ * \return The pixmap set by the wallpaper setter, or XCB_NONE.
+ */
+static xcb_pixmap_t
+widget_rootpixmap_get(int phys_screen)
+{
+    widget_rootpixmap_t *root = widget_rootpixmap_state(phys_screen);
+    xcb_get_property_reply_t *prop_r;
+    xcb_get_property_cookie_t prop_c;
+    xcb_screen_t *s;
+
+    if(root->isvalid)
+        return root->pixmap;
+
+    s = xutil_screen_get(globalconf.connection, phys_screen);
+    prop_c = xcb_get_property_unchecked(globalconf.connection, false, s->root, _XROOTPMAP_ID,
+                                        PIXMAP, 0, 1);
+    prop_r = xcb_get_property_reply(globalconf.connection, prop_c, NULL);
+    root->pixmap = widget_rootpixmap_from_reply(prop_r);
+    root->isvalid = true;
+    p_delete(&prop_r);
+
+    return root->pixmap;
+}
+
 /** Render a list of widgets.
  * \param wibox The wibox.
  * \todo Remove GC.
@@ -244,55 +368,23 @@ widget_render(wibox_t *wibox)
     rectangle.width = ctx->width;
     rectangle.height = ctx->height;
 
+    /* extents computed before this point are outdated */
+    widget_render_count++;
+
     if (!widget_geometries(wibox))
         return;
 
+    /* the pixmap is not rotated, the wallpaper is copied as is */
     if(ctx->bg.alpha != 0xffff)
     {
-        int x = wibox->geometry.x + wibox->border_width,
-            y = wibox->geometry.y + wibox->border_width;
-        xcb_get_property_reply_t *prop_r;
-        char *data;
-        xcb_pixmap_t rootpix;
-        xcb_get_property_cookie_t prop_c;
-        xcb_screen_t *s = xutil_screen_get(globalconf.connection, ctx->phys_screen);
-        prop_c = xcb_get_property_unchecked(globalconf.connection, false, s->root, _XROOTPMAP_ID,
-                                            PIXMAP, 0, 1);
-        if((prop_r = xcb_get_property_reply(globalconf.connection, prop_c, NULL)))
-        {
-            if(prop_r->value_len
-               && (data = xcb_get_property_value(prop_r))
-               && (rootpix = *(xcb_pixmap_t *) data))
-               switch(wibox->orientation)
-               {
-                 case North:
-                   draw_rotate(ctx,
-                               rootpix, ctx->pixmap,
-                               s->width_in_pixels, s->height_in_pixels,
-                               ctx->width, ctx->height,
-                               M_PI_2,
-                               y + ctx->width,
-                               - x);
-                   break;
-                 case South:
-                   draw_rotate(ctx,
-                               rootpix, ctx->pixmap,
-                               s->width_in_pixels, s->height_in_pixels,
-                               ctx->width, ctx->height,
-                               - M_PI_2,
-                               - y,
-                               x + ctx->height);
-                   break;
-                 case East:
-                   xcb_copy_area(globalconf.connection, rootpix,
-                                 wibox->pixmap, wibox->gc,
-                                 x, y,
-                                 0, 0,
-                                 ctx->width, ctx->height);
-                   break;
-               }
-            p_delete(&prop_r);
-        }
+        xcb_pixmap_t rootpix = widget_rootpixmap_get(ctx->phys_screen);
+        if(rootpix)
+            xcb_copy_area(globalconf.connection, rootpix,
+                          wibox->pixmap, wibox->gc,
+                          wibox->geometry.x + wibox->border_width,
+                          wibox->geometry.y + wibox->border_width,
+                          0, 0,
+                          wibox->geometry.width, wibox->geometry.height);
     }
 
     widget_node_array_t *widgets = &wibox->widgets;
@@ -322,6 +414,10 @@ widget_render(wibox_t *wibox)
     }
     lua_pop(L, 1);
 
+    /* remember what the widgets asked for, so we know when to relayout */
+    foreach(node, *widgets)
+        node->extents = widget_node_extents(wibox, node, true);
+
     /* draw background image, only if the background color is not opaque */
     if(wibox->bg_image && ctx->bg.alpha != 0xffff)
         draw_image(ctx, 0, 0, 1.0, wibox->bg_image);
@@ -335,24 +431,93 @@ widget_render(wibox_t *wibox)
         if(widgets->tab[i].widget->isvisible)
             widgets->tab[i].widget->draw(widgets->tab[i].widget,
                                          ctx, widgets->tab[i].geometry, wibox);
+}
+
+/** Redraw the invalidated widgets of a wibox only, reusing the geometries
+ * computed by the last full render.
+ * \param wibox The wibox.
+ * \param dirty The redrawn area, in window coordinates.
+ * \return False if a full render is needed, true otherwise.
+ */
+bool
+widget_render_partial(wibox_t *wibox, area_t *dirty)
+{
+    draw_context_t *ctx = &wibox->ctx;
+    xcb_pixmap_t rootpix = XCB_NONE;
+    int x1 = ctx->width, y1 = ctx->height, x2 = 0, y2 = 0;
+    color_t col;
+
+    /* a widget changing its size needs the whole wibox to be laid out */
+    foreach(node, wibox->widgets)
+        if(node->need_update)
+        {
+            area_t extents = widget_node_extents(wibox, node, false);
+            if(extents.width != node->extents.width
+               || extents.height != node->extents.height)
+                return false;
+        }
+
+    if(ctx->bg.alpha != 0xffff)
+        rootpix = widget_rootpixmap_get(ctx->phys_screen);
+
+    xcolor_to_color(&ctx->bg, &col);
+
+    foreach(node, wibox->widgets)
+        if(node->need_update)
+        {
+            area_t geometry = node->geometry;
+            int gx2 = MIN(AREA_RIGHT(geometry), ctx->width),
+                gy2 = MIN(AREA_BOTTOM(geometry), ctx->height);
+
+            node->need_update = false;
+
+            geometry.x = MAX(geometry.x, 0);
+            geometry.y = MAX(geometry.y, 0);
+            if(gx2 <= geometry.x || gy2 <= geometry.y)
+                continue;
+            geometry.width = gx2 - geometry.x;
+            geometry.height = gy2 - geometry.y;
+
+            if(rootpix)
+            {
+                area_t area = draw_area_to_pixmap(ctx, geometry);
+                xcb_copy_area(globalconf.connection, rootpix,
+                              wibox->pixmap, wibox->gc,
+                              wibox->geometry.x + wibox->border_width + area.x,
+                              wibox->geometry.y + wibox->border_width + area.y,
+                              area.x, area.y,
+                              area.width, area.height);
+            }
+
+            cairo_save(ctx->cr);
+            cairo_rectangle(ctx->cr, geometry.x, geometry.y, geometry.width, geometry.height);
+            cairo_clip(ctx->cr);
+
+            if(wibox->bg_image && ctx->bg.alpha != 0xffff)
+                draw_image(ctx, 0, 0, 1.0, wibox->bg_image);
 
-    switch(wibox->orientation)
+            draw_rectangle(ctx, geometry, 1.0, true, &col);
+
+            if(node->widget->isvisible)
+                node->widget->draw(node->widget, ctx, node->geometry, wibox);
+
+            cairo_restore(ctx->cr);
+
+            x1 = MIN(x1, geometry.x);
+            y1 = MIN(y1, geometry.y);
+            x2 = MAX(x2, gx2);
+            y2 = MAX(y2, gy2);
+        }
+
+    if(x2 <= x1 || y2 <= y1)
     {
-        case South:
-          draw_rotate(ctx, ctx->pixmap, wibox->pixmap,
-                      ctx->width, ctx->height,
-                      ctx->height, ctx->width,
-                      M_PI_2, ctx->height, 0);
-          break;
-        case North:
-          draw_rotate(ctx, ctx->pixmap, wibox->pixmap,
-                      ctx->width, ctx->height,
-                      ctx->height, ctx->width,
-                      - M_PI_2, 0, ctx->width);
-          break;
-        case East:
-          break;
+        p_clear(dirty, 1);
+        return true;
     }
+
+    *dirty = draw_area_to_pixmap(ctx, (area_t) { x1, y1, x2 - x1, y2 - y1 });
+
+    return true;
 }
 
 /** Invalidate widgets which should be refresh depending on their types.
@@ -370,32 +535,33 @@ widget_invalidate_bytype(widget_constructor_t *type)
             }
 }
 
-/** Set a wibox needs update because it has widget, or redraw a titlebar.
+/** Mark the nodes of a widget in a wibox as needing a redraw.
+ * \param wibox The wibox.
+ * \param widget The widget to look for.
+ */
+static void
+widget_invalidate_wibox(wibox_t *wibox, widget_t *widget)
+{
+    if(!wibox->need_update)
+        foreach(wnode, wibox->widgets)
+            if(wnode->widget == widget)
+            {
+                wnode->need_update = true;
+                wibox->need_widget_update = true;
+            }
+}
+
+/** Set the widget needs to be redrawn on the wiboxes and titlebars it is in.
  * \param widget The widget to look for.
  */
 void
 widget_invalidate_bywidget(widget_t *widget)
 {
-    foreach(wibox, globalconf.wiboxes)
-        if(!(*wibox)->need_update)
-            foreach(wnode, (*wibox)->widgets)
-                if(wnode->widget == widget)
-                {
-                    (*wibox)->need_update = true;
-                    break;
-                }
-
-    foreach(_c, globalconf.clients)
-    {
-        client_t *c = *_c;
-        if(c->titlebar && !c->titlebar->need_update)
-            for(int j = 0; j < c->titlebar->widgets.len; j++)
-                if(c->titlebar->widgets.tab[j].widget == widget)
-                {
-                    c->titlebar->need_update = true;
-                    break;
-                }
-    }
+    wibox_item_t *witem = wibox_item_getbyitem(widget);
+
+    if(witem)
+        foreach(wibox, witem->wiboxes)
+            widget_invalidate_wibox((wibox_t *) *wibox, widget);
 }
 
 /** Create a new widget.
@@ -495,7 +661,7 @@ luaA_widget_extents(lua_State *L)
     };
 
     if(widget->extents)
-        g = widget->extents(L, widget);
+        g = widget_extents_get(L, widget);
 
     lua_newtable(L);
     lua_pushnumber(L, g.width);
@@ -52,6 +52,10 @@ struct widget_t
     button_array_t buttons;
     /** True if the widget is visible */
     bool isvisible;
+    /** The extents last returned by the extents function */
+    area_t last_extents;
+    /** The render during which last_extents was computed */
+    unsigned int last_render;
 };
 
 void widget_node_delete(widget_node_t *);
@@ -62,11 +66,18 @@ struct widget_node
     widget_t *widget;
     /** The geometry where the widget was drawn */
     area_t geometry;
+    /** The extents the widget asked for when it was laid out */
+    area_t extents;
+    /** The widget needs to be redrawn */
+    bool need_update;
 };
 DO_ARRAY(widget_node_t, widget_node, widget_node_delete)
 
 widget_t *widget_getbycoords(orientation_t, widget_node_array_t *, int, int, int16_t *, int16_t *);
 void widget_render(wibox_t *);
+bool widget_render_partial(wibox_t *, area_t *);
+
+void widget_rootpixmap_update(int, xcb_get_property_reply_t *);
 
 void widget_invalidate_bywidget(widget_t *);
 void widget_invalidate_bytype(widget_constructor_t *);
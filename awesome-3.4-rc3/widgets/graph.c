@@ -46,10 +46,19 @@ typedef struct
     /* markers... */
     /** Index of current (new) value */
     int index;
-    /** Index of the actual maximum value */
-    int max_index;
+    /** Indexes of the decreasing values following the maximum, maximum first,
+     * as a ring of the graph size */
+    int *max_deque;
+    /** Index of the first element of max_deque */
+    int max_first;
+    /** Number of elements in max_deque */
+    int max_len;
     /** Pointer to current maximum value itself */
     float current_max;
+    /** Maximum value the lines have been computed with */
+    float lines_max;
+    /** Box height the lines have been computed with */
+    int lines_height;
     /** Draw style of according index */
     plot_style_t draw_style;
     /** Keeps the calculated values (line-length); */
@@ -72,6 +81,7 @@ plot_delete(plot_t *g)
     p_delete(&g->title);
     p_delete(&g->lines);
     p_delete(&g->values);
+    p_delete(&g->max_deque);
 }
 
 DO_ARRAY(plot_t, plot, plot_delete)
@@ -116,7 +126,8 @@ graph_plot_add(graph_data_t *d, const char *title)
     plot.title = a_strdup(title);
     plot.values = p_new(float, d->size);
     plot.lines = p_new(int, d->size);
-    plot.max_value = 100.0;
+    plot.max_deque = p_new(int, d->size);
+    plot.max_value = plot.current_max = 100.0;
     plot.vertical_gradient = true;
 
     xcolor_to_color(&globalconf.colors.fg, &plot.color_start);
@@ -148,6 +159,103 @@ graph_plot_get(graph_data_t *d, const char *title)
     return graph_plot_add(d, title);
 }
 
+/** Get the value a full plot represents.
+ * \param plot The plot.
+ * \return The maximum value.
+ */
+static float
+graph_plot_max(plot_t *plot)
+{
+    return plot->scale ? plot->current_max : plot->max_value;
+}
+
+/** Compute the length of a plot line.
+ * \param d The graph private data.
+ * \param plot The plot.
+ * \param i The line index.
+ */
+static void
+graph_plot_line_update(graph_data_t *d, plot_t *plot, int i)
+{
+    float max = graph_plot_max(plot);
+
+    if(max <= 0)
+        plot->lines[i] = 0;
+    else if(plot->values[i] < max)
+        plot->lines[i] = round(plot->values[i] * d->box_height / max);
+    else
+        plot->lines[i] = d->box_height;
+}
+
+/** Recompute all the plot lines if the scale or the height changed since
+ * they were computed.
+ * \param d The graph private data.
+ * \param plot The plot.
+ */
+static void
+graph_plot_lines_update(graph_data_t *d, plot_t *plot)
+{
+    if(plot->lines_max == graph_plot_max(plot) && plot->lines_height == d->box_height)
+        return;
+
+    plot->lines_max = graph_plot_max(plot);
+    plot->lines_height = d->box_height;
+
+    for(int i = 0; i < d->size; i++)
+        graph_plot_line_update(d, plot, i);
+}
+
+/** Add a value to a plot.
+ * The maximum of the values shown is kept in a monotonic deque, so it is
+ * known in constant amortized time without rescanning the values.
+ * \param d The graph private data.
+ * \param plot The plot.
+ * \param value The value.
+ */
+static void
+graph_plot_value_add(graph_data_t *d, plot_t *plot, float value)
+{
+    if(++plot->index >= d->size) /* cycle inside the array */
+        plot->index = 0;
+
+    /* the value overwritten is the oldest, so the first of the deque if any */
+    if(plot->max_len && plot->max_deque[plot->max_first] == plot->index)
+    {
+        if(++plot->max_first >= d->size)
+            plot->max_first = 0;
+        plot->max_len--;
+    }
+
+    plot->values[plot->index] = value;
+
+    /* drop the values that can no longer be the maximum */
+    while(plot->max_len
+          && plot->values[plot->max_deque[(plot->max_first + plot->max_len - 1) % d->size]] <= value)
+        plot->max_len--;
+
+    plot->max_deque[(plot->max_first + plot->max_len++) % d->size] = plot->index;
+
+    plot->current_max = MAX(plot->values[plot->max_deque[plot->max_first]], plot->max_value);
+
+    /* the other lines are updated at drawing time if the scale changed */
+    graph_plot_line_update(d, plot, plot->index);
+}
+
+/** Reset the values of a plot.
+ * \param d The graph private data.
+ * \param plot The plot.
+ */
+static void
+graph_plot_values_reset(graph_data_t *d, plot_t *plot)
+{
+    p_clear(plot->values, d->size);
+    p_clear(plot->lines, d->size);
+    plot->index = 0;
+    plot->max_first = 0;
+    plot->max_len = 0;
+    plot->current_max = plot->max_value;
+}
+
 static area_t
 graph_geometry(widget_t *widget, int screen)
 {
@@ -216,6 +324,8 @@ graph_draw(widget_t *widget, draw_context_t *ctx,
     {
         plot_t *plot = &d->plots.tab[i];
 
+        graph_plot_lines_update(d, plot);
+
         switch(plot->draw_style)
         {
             case Top_Style:
@@ -334,7 +444,13 @@ luaA_graph_plot_properties_set(lua_State *L)
 
     max_value = luaA_getopt_number(L, 3, "max_value", plot->max_value);
     if(max_value != plot->max_value)
-        plot->max_value = plot->current_max = max_value;
+    {
+        plot->max_value = max_value;
+        if(plot->max_len)
+            plot->current_max = MAX(plot->values[plot->max_deque[plot->max_first]], max_value);
+        else
+            plot->current_max = max_value;
+    }
 
     if((buf = luaA_getopt_lstring(L, 3, "style", NULL, &len)))
         switch (a_tokenize(buf, len))
@@ -366,7 +482,7 @@ luaA_graph_plot_properties_set(lua_State *L)
  * \luastack
  * \lvalue A widget.
  * \lparam A plot name.
- * \lparam A data value.
+ * \lparam A data value, or a table of data values to add in order.
  */
 static int
 luaA_graph_plot_data_add(lua_State *L)
@@ -375,57 +491,27 @@ luaA_graph_plot_data_add(lua_State *L)
     graph_data_t *d = widget->data;
     plot_t *plot = NULL;
     const char *title = luaL_checkstring(L, 2);
-    float value;
-    int i;
 
     if(!d->size)
         return 0;
 
-    plot = graph_plot_get(d, title);
-
-    /* assign incoming value */
-    value = MAX(luaL_checknumber(L, 3), 0);
-
-    if(++plot->index >= d->size) /* cycle inside the array */
-        plot->index = 0;
-
-    if(plot->scale) /* scale option is true */
+    if(lua_istable(L, 3))
     {
-        plot->values[plot->index] = value;
+        size_t len = lua_objlen(L, 3);
 
-        if(value > plot->current_max) /* a new maximum value found */
-        {
-            plot->max_index = plot->index;
-            plot->current_max = value;
+        plot = graph_plot_get(d, title);
 
-            /* recalculate */
-            for (i = 0; i < d->size; i++)
-                plot->lines[i] = round(plot->values[i] * d->box_height / plot->current_max);
-        }
-        /* old max_index reached + current_max > normal, re-check/generate */
-        else if(plot->max_index == plot->index
-                && plot->current_max > plot->max_value)
+        for(size_t i = 1; i <= len; i++)
         {
-            /* find the new max */
-            for(i = 0; i < d->size; i++)
-                if(plot->values[i] > plot->values[plot->max_index])
-                    plot->max_index = i;
-
-            plot->current_max = MAX(plot->values[plot->max_index], plot->max_value);
-
-            /* recalculate */
-            for(i = 0; i < d->size; i++)
-                plot->lines[i] = round(plot->values[i] * d->box_height / plot->current_max);
+            lua_rawgeti(L, 3, i);
+            graph_plot_value_add(d, plot, MAX(luaL_checknumber(L, -1), 0));
+            lua_pop(L, 1);
         }
-        else
-            plot->lines[plot->index] = round(value * d->box_height / plot->current_max);
     }
-    else /* scale option is false - limit to d->box_height */
+    else
     {
-        if(value < plot->max_value)
-            plot->lines[plot->index] = round(value * d->box_height / plot->max_value);
-        else
-            plot->lines[plot->index] = d->box_height;
+        plot = graph_plot_get(d, title);
+        graph_plot_value_add(d, plot, MAX(luaL_checknumber(L, 3), 0));
     }
 
     widget_invalidate_bywidget(widget);
@@ -526,11 +612,8 @@ luaA_graph_newindex(lua_State *L, awesome_token_t token)
                 plot_t *plot = &d->plots.tab[i];
                 p_realloc(&plot->values, d->size);
                 p_realloc(&plot->lines, d->size);
-                p_clear(plot->values, d->size);
-                p_clear(plot->lines, d->size);
-                plot->index = 0;
-                plot->current_max =  0;
-                plot->max_index =  0;
+                p_realloc(&plot->max_deque, d->size);
+                graph_plot_values_reset(d, plot);
             }
         }
         else
@@ -109,34 +109,83 @@ window_buttons_grab(xcb_window_t win, button_array_t *buttons)
                         (*b)->button, (*b)->modifiers);
 }
 
-/** Grab key on a window.
+/** Check if two runs of key grabs are the same.
+ * \param a The first grabs.
+ * \param alen The number of first grabs.
+ * \param b The second grabs.
+ * \param blen The number of second grabs.
+ * \return True if they are the same.
+ */
+static bool
+window_grabs_equal(const key_grab_t *a, int alen, const key_grab_t *b, int blen)
+{
+    if(alen != blen)
+        return false;
+
+    for(int i = 0; i < alen; i++)
+        if(key_grab_cmp(&a[i], &b[i]))
+            return false;
+
+    return true;
+}
+
+/** Update the keys grabbed on a window, sending only the grabs and ungrabs
+ * needed to go from one set of key combinations to another.
  * \param win The window.
- * \param k The key.
+ * \param grabbed The combinations currently grabbed.
+ * \param grabs The combinations to grab.
  */
-static void
-window_grabkey(xcb_window_t win, keyb_t *k)
+void
+window_grabkeys(xcb_window_t win, const key_grab_array_t *grabbed, const key_grab_array_t *grabs)
 {
-    if(k->keycode)
-        xcb_grab_key(globalconf.connection, true, win,
-                     k->modifiers, k->keycode, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
-    else if(k->keysym)
+    int i = 0, j = 0;
+
+    while(i < grabbed->len || j < grabs->len)
     {
-        xcb_keycode_t *keycodes = xcb_key_symbols_get_keycode(globalconf.keysyms, k->keysym);
-        if(keycodes)
+        xcb_keycode_t keycode;
+        int ostart = i, nstart = j;
+        bool any = false;
+
+        if(j >= grabs->len || (i < grabbed->len && grabbed->tab[i].keycode <= grabs->tab[j].keycode))
+            keycode = grabbed->tab[i].keycode;
+        else
+            keycode = grabs->tab[j].keycode;
+
+        for(; i < grabbed->len && grabbed->tab[i].keycode == keycode; i++)
+            any |= grabbed->tab[i].modifiers == XCB_BUTTON_MASK_ANY;
+        for(; j < grabs->len && grabs->tab[j].keycode == keycode; j++)
+            any |= grabs->tab[j].modifiers == XCB_BUTTON_MASK_ANY;
+
+        if(any)
         {
-            for(xcb_keycode_t *kc = keycodes; *kc; kc++)
-                xcb_grab_key(globalconf.connection, true, win,
-                             k->modifiers, *kc, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
-            p_delete(&keycodes);
+            /* Ungrabbing one modifier combination would punch a hole in a
+             * grab with any modifier, so do this key again from scratch */
+            if(window_grabs_equal(grabbed->tab + ostart, i - ostart, grabs->tab + nstart, j - nstart))
+                continue;
+
+            xcb_ungrab_key(globalconf.connection, keycode, win, XCB_BUTTON_MASK_ANY);
+            for(int k = nstart; k < j; k++)
+                xcb_grab_key(globalconf.connection, true, win, grabs->tab[k].modifiers,
+                             keycode, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
+            continue;
         }
-    }
-}
 
-void
-window_grabkeys(xcb_window_t win, key_array_t *keys)
-{
-    foreach(k, *keys)
-        window_grabkey(win, *k);
+        for(int o = ostart, n = nstart; o < i || n < j;)
+        {
+            int cmp = o >= i ? 1 : (n >= j ? -1 : key_grab_cmp(&grabbed->tab[o], &grabs->tab[n]));
+
+            if(cmp < 0)
+                xcb_ungrab_key(globalconf.connection, keycode, win, grabbed->tab[o++].modifiers);
+            else if(cmp > 0)
+                xcb_grab_key(globalconf.connection, true, win, grabs->tab[n++].modifiers,
+                             keycode, XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
+            else
+            {
+                o++;
+                n++;
+            }
+        }
+    }
 }
 
 /** Get the opacity of a window.
@@ -225,4 +274,47 @@ window_set_cursor(xcb_window_t w, xcb_cursor_t c)
                                  (const uint32_t[]) { c });
 }
 
+/** Record the objects owning a window, so they can be found back from it.
+ * \param win The window.
+ * \param c The client owning the window, or NULL.
+ * \param w The wibox owning the window, or NULL.
+ */
+void
+window_owner_register(xcb_window_t win, client_t *c, wibox_t *w)
+{
+    window_owner_t *owner = window_owner_getbywin(win);
+
+    if(owner)
+    {
+        owner->client = c;
+        owner->wibox = w;
+    }
+    else
+        window_owner_array_insert(&globalconf.windows,
+                                  (window_owner_t) { .window = win, .client = c, .wibox = w });
+}
+
+/** Forget about the objects owning a window.
+ * \param win The window.
+ */
+void
+window_owner_unregister(xcb_window_t win)
+{
+    window_owner_t *owner = window_owner_getbywin(win);
+
+    if(owner)
+        window_owner_array_remove(&globalconf.windows, owner);
+}
+
+/** Get the objects owning a window.
+ * \param win The window.
+ * \return The window owner entry, or NULL if the window is unknown.
+ */
+window_owner_t *
+window_owner_getbywin(xcb_window_t win)
+{
+    window_owner_t lookup = { .window = win };
+    return window_owner_array_lookup(&globalconf.windows, &lookup);
+}
+
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80
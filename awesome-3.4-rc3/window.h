@@ -34,9 +34,12 @@ double window_opacity_get(xcb_window_t);
 double window_opacity_get_from_reply(xcb_get_property_reply_t *);
 void window_opacity_set(xcb_window_t, double);
 void window_grabbuttons(xcb_window_t, xcb_window_t, button_array_t *);
-void window_grabkeys(xcb_window_t, key_array_t *);
+void window_grabkeys(xcb_window_t, const key_grab_array_t *, const key_grab_array_t *);
 void window_takefocus(xcb_window_t);
 void window_set_cursor(xcb_window_t, xcb_cursor_t);
+void window_owner_register(xcb_window_t, client_t *, wibox_t *);
+void window_owner_unregister(xcb_window_t);
+window_owner_t * window_owner_getbywin(xcb_window_t);
 
 #endif
 // vim: filetype=c:expandtab:shiftwidth=4:tabstop=8:softtabstop=4:encoding=utf-8:textwidth=80